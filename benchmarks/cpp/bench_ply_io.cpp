@@ -0,0 +1,598 @@
+// Micro-benchmarks for the native PLY reading and writing kernels.
+//
+// Every case times one hot path in isolation on PLY data generated in memory,
+// so that no disk or Python overhead is included. Each case is repeated and
+// the fastest run is reported, as GB/s of PLY data processed and millions of
+// rows per second. With --dir, whole files are also written to that
+// directory, through a write buffer and through a memory mapping.
+//
+// Usage: bench_ply_io [--rows=N,N,...] [--threads=N,N,...] [--reps=N]
+//                     [--filter=SUBSTRING] [--dir=PATH] [--csv]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "miniply.h"
+#include "parallel.h"
+#include "ply_writer.h"
+
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// A property with its values stored column-wise, as the writer takes them.
+struct Column {
+    std::string name;
+    std::string type;
+    uint32_t value_size = 0;
+    bool is_integer = false;
+    bool is_list = false;
+    uint32_t list_size = 1;
+    std::vector<char> data;
+};
+
+struct Layout {
+    std::string name;
+    std::string element;
+    int64_t rows = 0;
+    std::vector<Column> columns;
+};
+
+enum class Format { Ascii, LittleEndian, BigEndian };
+
+const char* format_name(Format format) {
+    switch (format) {
+    case Format::Ascii:
+        return "ascii";
+    case Format::LittleEndian:
+        return "binary_little_endian";
+    default:
+        return "binary_big_endian";
+    }
+}
+
+const char* format_label(Format format) {
+    switch (format) {
+    case Format::Ascii:
+        return "ascii";
+    case Format::LittleEndian:
+        return "le";
+    default:
+        return "be";
+    }
+}
+
+// Deterministic pseudo-random numbers (splitmix64), so runs are comparable.
+struct Random {
+    uint64_t state;
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    float uniform() {
+        return float(next() >> 40) / float(1 << 24);
+    }
+};
+
+Column float_column(const std::string& name, int64_t rows, Random& random) {
+    Column column{name, "float", 4, false, false, 1, std::vector<char>(rows * 4)};
+    float* values = reinterpret_cast<float*>(column.data.data());
+    for (int64_t row = 0; row != rows; ++row) {
+        values[row] = random.uniform() * 2.0f - 1.0f;
+    }
+    return column;
+}
+
+Column uchar_column(const std::string& name, int64_t rows, Random& random) {
+    Column column{name, "uchar", 1, true, false, 1, std::vector<char>(rows)};
+    for (int64_t row = 0; row != rows; ++row) {
+        column.data[row] = char(random.next() & 0xff);
+    }
+    return column;
+}
+
+// xyz + rgb point cloud: a short row of mixed types.
+Layout point_cloud_layout(int64_t rows) {
+    Random random{1};
+    Layout layout{"xyz_rgb", "vertex", rows, {}};
+    for (const char* name : {"x", "y", "z"}) {
+        layout.columns.push_back(float_column(name, rows, random));
+    }
+    for (const char* name : {"red", "green", "blue"}) {
+        layout.columns.push_back(uchar_column(name, rows, random));
+    }
+    return layout;
+}
+
+// Gaussian splat: 62 floats per row, the widest layout in common use.
+Layout splat_layout(int64_t rows) {
+    Random random{2};
+    Layout layout{"splat62", "vertex", rows, {}};
+    std::vector<std::string> names = {"x", "y", "z", "nx", "ny", "nz", "f_dc_0", "f_dc_1", "f_dc_2"};
+    for (int i = 0; i < 45; ++i) {
+        names.push_back("f_rest_" + std::to_string(i));
+    }
+    for (const char* name : {"opacity", "scale_0", "scale_1", "scale_2", "rot_0", "rot_1", "rot_2", "rot_3"}) {
+        names.push_back(name);
+    }
+    for (const std::string& name : names) {
+        layout.columns.push_back(float_column(name, rows, random));
+    }
+    return layout;
+}
+
+// Triangle faces as "property list uchar int vertex_indices".
+Layout triangle_layout(int64_t rows) {
+    Random random{3};
+    Layout layout{"tri_faces", "face", rows, {}};
+    Column column{"vertex_indices", "int", 4, true, true, 3, std::vector<char>(rows * 12)};
+    int32_t* values = reinterpret_cast<int32_t*>(column.data.data());
+    for (int64_t i = 0; i != rows * 3; ++i) {
+        values[i] = int32_t(random.next() % uint64_t(std::max<int64_t>(rows / 2, 1)));
+    }
+    layout.columns.push_back(std::move(column));
+    return layout;
+}
+
+PLYWriteElement write_element(const Layout& layout) {
+    PLYWriteElement element;
+    element.name = layout.element;
+    element.count = layout.rows;
+    for (const Column& column : layout.columns) {
+        PLYWriteProperty property;
+        property.name = column.name;
+        property.type = column.type;
+        property.value_size = column.value_size;
+        property.data = column.data.data();
+        property.is_list = column.is_list;
+        property.list_size = column.list_size;
+        element.properties.push_back(property);
+    }
+    return element;
+}
+
+std::string header_for(const Layout& layout, Format format) {
+    std::string header = ply_header({write_element(layout)});
+    size_t begin = header.find("format ");
+    size_t end = header.find('\n', begin);
+    return header.replace(begin, end - begin, std::string("format ") + format_name(format) + " 1.0");
+}
+
+void append_ascii_value(std::string& out, const Column& column, int64_t index) {
+    char text[32];
+    int n;
+    if (column.type == "float") {
+        float value;
+        std::memcpy(&value, column.data.data() + index * 4, 4);
+        n = std::snprintf(text, sizeof(text), "%.9g", double(value));
+    } else if (column.type == "int") {
+        int32_t value;
+        std::memcpy(&value, column.data.data() + index * 4, 4);
+        n = std::snprintf(text, sizeof(text), "%d", value);
+    } else {
+        n = std::snprintf(text, sizeof(text), "%u", unsigned(uint8_t(column.data[index])));
+    }
+    out.append(text, size_t(n));
+}
+
+// The whole file for `layout` in `format`. Returns the size of the header in `header_size`.
+std::string make_ply(const Layout& layout, Format format, size_t& header_size) {
+    std::string ply = header_for(layout, format);
+    header_size = ply.size();
+
+    if (format == Format::Ascii) {
+        for (int64_t row = 0; row != layout.rows; ++row) {
+            for (const Column& column : layout.columns) {
+                if (column.is_list) {
+                    ply += std::to_string(column.list_size);
+                    for (uint32_t i = 0; i != column.list_size; ++i) {
+                        ply += ' ';
+                        append_ascii_value(ply, column, row * column.list_size + i);
+                    }
+                } else {
+                    append_ascii_value(ply, column, row);
+                }
+                ply += ' ';
+            }
+            ply.back() = '\n';
+        }
+        return ply;
+    }
+
+    PLYWriteElement element = write_element(layout);
+    ply.resize(header_size + size_t(ply_body_size({element})));
+    write_ply_body({element}, &ply[header_size],
+                   format == Format::BigEndian ? PLYByteOrder::BigEndian : PLYByteOrder::LittleEndian);
+    return ply;
+}
+
+// A source that hides where its data lives, so that the reader takes the
+// same copying path as for files and streams.
+std::unique_ptr<miniply::PLYSource> stream_source(const std::string& data) {
+    auto pos = std::make_shared<size_t>(0);
+    return std::make_unique<miniply::PLYCallbackSource>(
+        [&data, pos](void* dest, size_t size) {
+            size_t n = std::min(size, data.size() - *pos);
+            std::memcpy(dest, data.data() + *pos, n);
+            *pos += n;
+            return n;
+        },
+        [&data, pos](int64_t offset) {
+            if (offset < 0 || size_t(offset) > data.size()) {
+                return false;
+            }
+            *pos = size_t(offset);
+            return true;
+        });
+}
+
+std::unique_ptr<miniply::PLYReader> open_reader(const std::string& data, bool in_memory) {
+    std::unique_ptr<miniply::PLYSource> source = in_memory ?
+        std::make_unique<miniply::PLYMemorySource>(data.data(), data.size()) : stream_source(data);
+    auto reader = std::make_unique<miniply::PLYReader>(std::move(source));
+    if (!reader->valid() || !reader->has_element()) {
+        throw std::runtime_error("failed to parse generated PLY header");
+    }
+    return reader;
+}
+
+std::unique_ptr<miniply::PLYReader> loaded_reader(const std::string& data) {
+    std::unique_ptr<miniply::PLYReader> reader = open_reader(data, true);
+    if (!reader->load_element()) {
+        throw std::runtime_error("failed to load generated PLY element");
+    }
+    return reader;
+}
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+
+struct Options {
+    std::vector<int64_t> rows = {10000, 1000000};
+    std::vector<int64_t> threads;
+    int reps = 5;
+    std::string filter;
+    std::string dir;
+    bool csv = false;
+};
+
+std::vector<int64_t> parse_list(const char* text) {
+    std::vector<int64_t> values;
+    while (*text != '\0') {
+        char* end;
+        values.push_back(std::strtoll(text, &end, 10));
+        if (end == text || values.back() <= 0) {
+            throw std::runtime_error("expected a comma separated list of positive numbers");
+        }
+        text = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+Options parse_options(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--rows=") == 0) {
+            options.rows = parse_list(argv[i] + 7);
+        } else if (arg.compare(0, 10, "--threads=") == 0) {
+            options.threads = parse_list(argv[i] + 10);
+        } else if (arg.compare(0, 7, "--reps=") == 0) {
+            options.reps = std::max(1, std::atoi(argv[i] + 7));
+        } else if (arg.compare(0, 9, "--filter=") == 0) {
+            options.filter = arg.substr(9);
+        } else if (arg.compare(0, 6, "--dir=") == 0) {
+            options.dir = arg.substr(6);
+        } else if (arg == "--csv") {
+            options.csv = true;
+        } else {
+            throw std::runtime_error("unknown argument: " + arg);
+        }
+    }
+    if (options.threads.empty()) {
+        int64_t max_threads = int64_t(std::max(1u, std::thread::hardware_concurrency()));
+        for (int64_t n = 1; n < max_threads; n *= 2) {
+            options.threads.push_back(n);
+        }
+        options.threads.push_back(max_threads);
+    }
+    return options;
+}
+
+
+class Runner {
+public:
+    explicit Runner(const Options& options) : m_options(options) {
+        if (m_options.csv) {
+            std::printf("case,layout,rows,threads,bytes,ms,gb_per_s,mrows_per_s\n");
+        } else {
+            std::printf("%-22s %-14s %10s %7s %12s %10s %9s %10s\n", "case", "layout", "rows", "threads",
+                        "bytes", "ms", "GB/s", "Mrows/s");
+        }
+    }
+
+    // Runs `body` (which returns the seconds taken by the timed part of one
+    // repetition) and reports the fastest repetition.
+    void run(const std::string& name, const std::string& layout, int64_t rows, int64_t threads, int64_t bytes,
+             const std::function<double()>& body) {
+        if (!m_options.filter.empty() && (name + "/" + layout).find(m_options.filter) == std::string::npos) {
+            return;
+        }
+        set_num_worker_threads(threads);
+        double best = body();  // Warm up caches and page in the buffers.
+        for (int rep = 0; rep < m_options.reps; ++rep) {
+            best = std::min(best, body());
+        }
+        set_num_worker_threads(0);
+
+        best = std::max(best, 1e-9);
+        double gb_per_s = double(bytes) / best * 1e-9;
+        double mrows_per_s = double(rows) / best * 1e-6;
+        if (m_options.csv) {
+            std::printf("%s,%s,%lld,%lld,%lld,%.4f,%.3f,%.3f\n", name.c_str(), layout.c_str(), (long long)rows,
+                        (long long)threads, (long long)bytes, best * 1e3, gb_per_s, mrows_per_s);
+        } else {
+            std::printf("%-22s %-14s %10lld %7lld %12lld %10.3f %9.3f %10.3f\n", name.c_str(), layout.c_str(),
+                        (long long)rows, (long long)threads, (long long)bytes, best * 1e3, gb_per_s, mrows_per_s);
+        }
+        std::fflush(stdout);
+    }
+
+private:
+    const Options& m_options;
+};
+
+
+void bench_header(Runner& runner, const Layout& layout) {
+    // Only the header is parsed; the body is never touched.
+    size_t header_size;
+    std::string ply = make_ply(layout, Format::LittleEndian, header_size);
+    ply.resize(header_size);
+    runner.run("header_parse", layout.name, 1, 1, int64_t(header_size), [&]() {
+        Clock::time_point start = Clock::now();
+        miniply::PLYReader reader(std::make_unique<miniply::PLYMemorySource>(ply.data(), ply.size()));
+        double elapsed = seconds_since(start);
+        if (!reader.valid()) {
+            throw std::runtime_error("failed to parse generated PLY header");
+        }
+        return elapsed;
+    });
+}
+
+// Times `load_element` for the first element, which dispatches to
+// load_fixed_size_element or load_variable_size_element and, for ASCII and
+// big-endian data, the parsing and byte swapping code.
+// Loading a fixed-size element in memory only sets up a view of its rows, so
+// then every property is extracted too, as it is stored, for the rows to be
+// read at all.
+void bench_load(Runner& runner, const std::string& name, const Layout& layout, Format format, bool in_memory) {
+    size_t header_size;
+    std::string ply = make_ply(layout, format, header_size);
+    std::vector<std::vector<char>> columns;
+    for (size_t i = 0; in_memory && i != layout.columns.size(); ++i) {
+        columns.emplace_back(size_t(layout.rows) * layout.columns[i].value_size * layout.columns[i].list_size);
+    }
+    runner.run(name, layout.name + "/" + format_label(format), layout.rows, 1, int64_t(ply.size() - header_size),
+               [&]() {
+                   std::unique_ptr<miniply::PLYReader> reader = open_reader(ply, in_memory);
+                   Clock::time_point start = Clock::now();
+                   bool loaded = reader->load_element();
+                   for (uint32_t i = 0; loaded && i != uint32_t(columns.size()); ++i) {
+                       loaded = reader->extract_properties(&i, 1, reader->element()->properties[i].type,
+                                                           columns[i].data());
+                   }
+                   double elapsed = seconds_since(start);
+                   if (!loaded) {
+                       throw std::runtime_error("failed to load generated PLY element");
+                   }
+                   return elapsed;
+               });
+}
+
+void bench_extract(Runner& runner, const Layout& point_cloud, const Layout& splat, const Layout& triangles) {
+    size_t header_size;
+
+    // All properties of the row, no conversion: a single memcpy.
+    std::string splat_ply = make_ply(splat, Format::LittleEndian, header_size);
+    std::unique_ptr<miniply::PLYReader> splat_reader = loaded_reader(splat_ply);
+    std::vector<uint32_t> all_props(splat.columns.size());
+    for (uint32_t i = 0; i < all_props.size(); ++i) {
+        all_props[i] = i;
+    }
+    std::vector<float> splat_dest(size_t(splat.rows) * all_props.size());
+    runner.run("extract_contiguous", "splat62/float", splat.rows, 1, int64_t(splat_dest.size() * sizeof(float)),
+               [&]() {
+                   Clock::time_point start = Clock::now();
+                   splat_reader->extract_properties(all_props.data(), uint32_t(all_props.size()),
+                                                    miniply::PLYPropertyType::Float, splat_dest.data());
+                   return seconds_since(start);
+               });
+
+    // A few adjacent properties out of each row.
+    std::string cloud_ply = make_ply(point_cloud, Format::LittleEndian, header_size);
+    std::unique_ptr<miniply::PLYReader> cloud_reader = loaded_reader(cloud_ply);
+    uint32_t pos[3];
+    cloud_reader->find_pos(pos);
+    std::vector<double> pos_dest(size_t(point_cloud.rows) * 4);
+    runner.run("extract_subset", "xyz_rgb/xyz", point_cloud.rows, 1, point_cloud.rows * 12, [&]() {
+        Clock::time_point start = Clock::now();
+        cloud_reader->extract_properties(pos, 3, miniply::PLYPropertyType::Float, pos_dest.data());
+        return seconds_since(start);
+    });
+
+    // Every value converted to another type.
+    runner.run("extract_convert", "xyz_rgb/xyz>f8", point_cloud.rows, 1, point_cloud.rows * 24, [&]() {
+        Clock::time_point start = Clock::now();
+        cloud_reader->extract_properties(pos, 3, miniply::PLYPropertyType::Double, pos_dest.data());
+        return seconds_since(start);
+    });
+
+    // Rows written into an array of structs.
+    runner.run("extract_stride", "xyz_rgb/xyz:16", point_cloud.rows, 1, point_cloud.rows * 12, [&]() {
+        Clock::time_point start = Clock::now();
+        cloud_reader->extract_properties_with_stride(pos, 3, miniply::PLYPropertyType::Float, pos_dest.data(), 16);
+        return seconds_since(start);
+    });
+
+    // A list property, flattened.
+    std::string faces_ply = make_ply(triangles, Format::LittleEndian, header_size);
+    std::unique_ptr<miniply::PLYReader> faces_reader = loaded_reader(faces_ply);
+    uint32_t indices;
+    faces_reader->find_indices(&indices);
+    std::vector<int32_t> indices_dest(faces_reader->sum_of_list_counts(indices));
+    runner.run("extract_list", "tri_faces/int", triangles.rows, 1, int64_t(indices_dest.size() * sizeof(int32_t)),
+               [&]() {
+                   Clock::time_point start = Clock::now();
+                   faces_reader->extract_list_property(indices, miniply::PLYPropertyType::Int, indices_dest.data());
+                   return seconds_since(start);
+               });
+}
+
+void bench_write(Runner& runner, const Layout& layout, const std::vector<int64_t>& threads, const std::string& dir) {
+    std::vector<PLYWriteElement> elements = {write_element(layout)};
+    std::vector<char> body(size_t(ply_body_size(elements)));
+    for (int64_t n : threads) {
+        runner.run("write_interleave", layout.name, layout.rows, n, int64_t(body.size()), [&]() {
+            Clock::time_point start = Clock::now();
+            write_ply_body(elements, body.data());
+            return seconds_since(start);
+        });
+    }
+
+    // The same rows, byte-swapped on little-endian machines.
+    for (int64_t n : threads) {
+        runner.run("write_big_endian", layout.name, layout.rows, n, int64_t(body.size()), [&]() {
+            Clock::time_point start = Clock::now();
+            write_ply_body(elements, body.data(), PLYByteOrder::BigEndian);
+            return seconds_since(start);
+        });
+    }
+
+    // The same rows gathered from strided views of an array of rows, as when
+    // saving the columns of [N, C] tensors.
+    std::vector<char> rows = body;
+    std::vector<PLYWriteElement> views = elements;
+    int64_t offset = 0;
+    for (PLYWriteProperty& property : views.front().properties) {
+        offset += property.is_list ? 1 : 0;
+        property.data = rows.data() + offset;
+        property.stride = ply_row_size(elements.front());
+        offset += int64_t(property.value_size) * property.list_size;
+    }
+    for (int64_t n : threads) {
+        runner.run("write_gather", layout.name, layout.rows, n, int64_t(body.size()), [&]() {
+            Clock::time_point start = Clock::now();
+            write_ply_body(views, body.data());
+            return seconds_since(start);
+        });
+    }
+
+    // The same rows as text, with the fewest digits that read back exactly,
+    // formatted once beforehand to count the bytes produced.
+    std::string text;
+    format_ply_rows(elements.front(), 0, layout.rows, 0, text);
+    const int64_t text_size = int64_t(text.size());
+    for (int64_t n : threads) {
+        runner.run("write_ascii", layout.name, layout.rows, n, text_size, [&]() {
+            Clock::time_point start = Clock::now();
+            text.clear();
+            format_ply_rows(elements.front(), 0, layout.rows, 0, text);
+            return seconds_since(start);
+        });
+    }
+
+    if (dir.empty()) {
+        return;
+    }
+    // Whole files, interleaved a chunk at a time into a buffer written with
+    // an ofstream as write_ply does, and straight into a mapping of the file.
+    std::string path = dir + "/bench_ply_io_" + layout.name + ".ply";
+    std::string header = ply_header(elements);
+    int64_t file_size = int64_t(header.size()) + int64_t(body.size());
+    const int64_t chunk_bytes = 16 << 20;
+    for (int64_t n : threads) {
+        runner.run("write_file_stream", layout.name, layout.rows, n, file_size, [&]() {
+            Clock::time_point start = Clock::now();
+            std::ofstream file(path, std::ios::binary);
+            file.write(header.data(), std::streamsize(header.size()));
+            const PLYWriteElement& element = elements.front();
+            for (int64_t row = 0, row_end; row < element.count; row = row_end) {
+                row_end = ply_chunk_end(element, row, chunk_bytes, PLYWriteFormat::Binary);
+                int64_t size = ply_rows_size(element, row, row_end);
+                write_ply_rows(element, row, row_end, body.data());
+                file.write(body.data(), std::streamsize(size));
+            }
+            file.close();
+            return seconds_since(start);
+        });
+    }
+    for (int64_t n : threads) {
+        runner.run("write_file_mapped", layout.name, layout.rows, n, file_size, [&]() {
+            Clock::time_point start = Clock::now();
+            if (!write_ply_mapped(path, header, elements, PLYByteOrder::Native, false)) {
+                throw std::runtime_error("could not map " + path);
+            }
+            return seconds_since(start);
+        });
+    }
+    std::remove(path.c_str());
+}
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+    try {
+        Options options = parse_options(argc, argv);
+        Runner runner(options);
+
+        for (int64_t rows : options.rows) {
+            Layout point_cloud = point_cloud_layout(rows);
+            Layout splat = splat_layout(rows);
+            Layout triangles = triangle_layout(rows);
+
+            if (rows == options.rows.front()) {
+                bench_header(runner, point_cloud);
+                bench_header(runner, splat);
+            }
+
+            for (const Layout* layout : {&point_cloud, &splat}) {
+                bench_load(runner, "load_fixed_copy", *layout, Format::LittleEndian, false);
+                bench_load(runner, "load_fixed_inplace", *layout, Format::LittleEndian, true);
+                bench_load(runner, "load_big_endian", *layout, Format::BigEndian, false);
+                bench_load(runner, "load_ascii", *layout, Format::Ascii, false);
+            }
+            bench_load(runner, "load_variable", triangles, Format::LittleEndian, false);
+            bench_load(runner, "load_variable_be", triangles, Format::BigEndian, false);
+            bench_load(runner, "load_variable_ascii", triangles, Format::Ascii, false);
+
+            bench_extract(runner, point_cloud, splat, triangles);
+
+            for (const Layout* layout : {&point_cloud, &splat, &triangles}) {
+                bench_write(runner, *layout, options.threads, options.dir);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "bench_ply_io: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
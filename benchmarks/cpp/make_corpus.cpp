@@ -0,0 +1,389 @@
+// Writes a reproducible corpus of PLY files for benchmarking.
+//
+// Every value is a hash of (seed, stream, row), so any row can be generated
+// independently, in parallel, and the output depends only on the options.
+// benchmarks/make_corpus.py implements the same scheme and writes
+// byte-identical files; this tool is the fast one, for the large corpora.
+//
+//   hash(seed, stream, row) = mix(seed * 0x9e3779b97f4a7c15 + stream * 0xd1b54a32d192ed03 + row)
+//   mix(z): z = (z ^ z >> 30) * 0xbf58476d1ce4e5b9; z = (z ^ z >> 27) * 0x94d049bb133111eb; z ^ z >> 31
+//
+// Vertex property `i` uses stream `i`: floats are (hash >> 40) * 2^-23 - 1,
+// uchars the low byte of the hash. Face sizes use stream 100 (3 + hash % 4 for
+// mixed faces), face corner `j` stream 101 + j, taken modulo the vertex count.
+//
+// Usage: make_corpus OUTPUT_DIR [--rows=N] [--seed=N] [--tiny-files=N]
+//                    [--tiny-rows=N] [--huge] [--huge-bytes=N]
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "parallel.h"
+
+
+namespace {
+
+// Rows generated per write, and per parallel block within it.
+constexpr int64_t kChunkRows = 1 << 16;
+constexpr int64_t kBlockRows = 1 << 12;
+
+constexpr uint64_t kFaceSizeStream = 100;
+constexpr uint64_t kFaceCornerStream = 101;
+
+enum class Format { Ascii, LittleEndian, BigEndian };
+
+enum class Layout { Points, Splat, TriMesh, QuadMesh, MixedMesh };
+
+const Format kFormats[] = {Format::Ascii, Format::LittleEndian, Format::BigEndian};
+
+const Layout kLayouts[] = {Layout::Points, Layout::Splat, Layout::TriMesh, Layout::QuadMesh, Layout::MixedMesh};
+
+const char* format_name(Format format) {
+    switch (format) {
+    case Format::Ascii:
+        return "ascii";
+    case Format::LittleEndian:
+        return "binary_little_endian";
+    default:
+        return "binary_big_endian";
+    }
+}
+
+const char* format_label(Format format) {
+    switch (format) {
+    case Format::Ascii:
+        return "ascii";
+    case Format::LittleEndian:
+        return "le";
+    default:
+        return "be";
+    }
+}
+
+const char* layout_label(Layout layout) {
+    switch (layout) {
+    case Layout::Points:
+        return "points";
+    case Layout::Splat:
+        return "splat";
+    case Layout::TriMesh:
+        return "tri_mesh";
+    case Layout::QuadMesh:
+        return "quad_mesh";
+    default:
+        return "mixed_mesh";
+    }
+}
+
+uint64_t hash(uint64_t seed, uint64_t stream, uint64_t row) {
+    uint64_t z = seed * 0x9e3779b97f4a7c15ull + stream * 0xd1b54a32d192ed03ull + row;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+float hash_float(uint64_t seed, uint64_t stream, uint64_t row) {
+    return float(hash(seed, stream, row) >> 40) * (1.0f / float(1 << 23)) - 1.0f;
+}
+
+struct VertexProperty {
+    std::string name;
+    bool is_uchar;
+};
+
+std::vector<VertexProperty> vertex_properties(Layout layout) {
+    std::vector<VertexProperty> properties = {{"x", false}, {"y", false}, {"z", false}};
+    if (layout == Layout::Points) {
+        for (const char* name : {"red", "green", "blue"}) {
+            properties.push_back({name, true});
+        }
+    } else if (layout == Layout::Splat) {
+        for (const char* name : {"nx", "ny", "nz", "f_dc_0", "f_dc_1", "f_dc_2"}) {
+            properties.push_back({name, false});
+        }
+        for (int i = 0; i < 45; ++i) {
+            properties.push_back({"f_rest_" + std::to_string(i), false});
+        }
+        for (const char* name : {"opacity", "scale_0", "scale_1", "scale_2", "rot_0", "rot_1", "rot_2", "rot_3"}) {
+            properties.push_back({name, false});
+        }
+    }
+    return properties;
+}
+
+bool has_faces(Layout layout) {
+    return layout == Layout::TriMesh || layout == Layout::QuadMesh || layout == Layout::MixedMesh;
+}
+
+uint8_t face_size(Layout layout, uint64_t seed, uint64_t row) {
+    switch (layout) {
+    case Layout::TriMesh:
+        return 3;
+    case Layout::QuadMesh:
+        return 4;
+    default:
+        return uint8_t(3 + hash(seed, kFaceSizeStream, row) % 4);
+    }
+}
+
+// Appends values to a block of rows in one of the PLY encodings.
+class RowEncoder {
+public:
+    RowEncoder(Format format, std::string& out) : m_format(format), m_out(out) {}
+
+    void put_float(float value) {
+        if (m_format == Format::Ascii) {
+            put_text("%.9g", double(value));
+        } else {
+            put_binary(&value, sizeof(value));
+        }
+    }
+
+    void put_uchar(uint8_t value) {
+        if (m_format == Format::Ascii) {
+            put_text("%u", unsigned(value));
+        } else {
+            m_out.push_back(char(value));
+        }
+    }
+
+    void put_int(int32_t value) {
+        if (m_format == Format::Ascii) {
+            put_text("%d", value);
+        } else {
+            put_binary(&value, sizeof(value));
+        }
+    }
+
+    void end_row() {
+        if (m_format == Format::Ascii) {
+            m_out.push_back('\n');
+            m_rowStarted = false;
+        }
+    }
+
+private:
+    template <class T>
+    void put_text(const char* format, T value) {
+        char text[32];
+        int n = std::snprintf(text, sizeof(text), format, value);
+        if (m_rowStarted) {
+            m_out.push_back(' ');
+        }
+        m_out.append(text, size_t(n));
+        m_rowStarted = true;
+    }
+
+    // Values are generated in the byte order of this (little-endian) machine.
+    void put_binary(const void* value, size_t size) {
+        size_t pos = m_out.size();
+        m_out.append(static_cast<const char*>(value), size);
+        if (m_format == Format::BigEndian) {
+            std::reverse(m_out.begin() + pos, m_out.end());
+        }
+    }
+
+    Format m_format;
+    std::string& m_out;
+    bool m_rowStarted = false;
+};
+
+void encode_vertices(const std::vector<VertexProperty>& properties, uint64_t seed, int64_t begin, int64_t end,
+                     RowEncoder& encoder) {
+    for (int64_t row = begin; row != end; ++row) {
+        for (size_t i = 0; i < properties.size(); ++i) {
+            if (properties[i].is_uchar) {
+                encoder.put_uchar(uint8_t(hash(seed, i, uint64_t(row))));
+            } else {
+                encoder.put_float(hash_float(seed, i, uint64_t(row)));
+            }
+        }
+        encoder.end_row();
+    }
+}
+
+void encode_faces(Layout layout, uint64_t seed, int64_t num_vertices, int64_t begin, int64_t end,
+                  RowEncoder& encoder) {
+    for (int64_t row = begin; row != end; ++row) {
+        uint8_t size = face_size(layout, seed, uint64_t(row));
+        encoder.put_uchar(size);
+        for (uint8_t j = 0; j < size; ++j) {
+            encoder.put_int(int32_t(hash(seed, kFaceCornerStream + j, uint64_t(row)) % uint64_t(num_vertices)));
+        }
+        encoder.end_row();
+    }
+}
+
+std::string header(Layout layout, Format format, uint64_t seed, int64_t rows) {
+    std::string text = "ply\nformat " + std::string(format_name(format)) + " 1.0\n";
+    text += "comment make_corpus layout=" + std::string(layout_label(layout)) + " seed=" + std::to_string(seed) + "\n";
+    text += "element vertex " + std::to_string(rows) + "\n";
+    for (const VertexProperty& property : vertex_properties(layout)) {
+        text += std::string("property ") + (property.is_uchar ? "uchar " : "float ") + property.name + "\n";
+    }
+    if (has_faces(layout)) {
+        text += "element face " + std::to_string(rows) + "\n";
+        text += "property list uchar int vertex_indices\n";
+    }
+    text += "end_header\n";
+    return text;
+}
+
+// Writes `rows` rows of an element a chunk at a time, blocks of each chunk
+// being encoded in parallel.
+template <class EncodeRows>
+void write_rows(FILE* f, int64_t rows, const EncodeRows& encode_rows) {
+    std::vector<std::string> blocks(size_t((kChunkRows + kBlockRows - 1) / kBlockRows));
+    for (int64_t chunk = 0; chunk < rows; chunk += kChunkRows) {
+        int64_t chunk_end = std::min(rows, chunk + kChunkRows);
+        int64_t num_blocks = (chunk_end - chunk + kBlockRows - 1) / kBlockRows;
+        parallel_for(0, num_blocks, 1, [&](int64_t block_begin, int64_t block_end) {
+            for (int64_t block = block_begin; block != block_end; ++block) {
+                int64_t begin = chunk + block * kBlockRows;
+                blocks[block].clear();
+                encode_rows(begin, std::min(chunk_end, begin + kBlockRows), blocks[block]);
+            }
+        });
+        for (int64_t block = 0; block != num_blocks; ++block) {
+            if (std::fwrite(blocks[block].data(), 1, blocks[block].size(), f) != blocks[block].size()) {
+                throw std::runtime_error("failed to write corpus file");
+            }
+        }
+    }
+}
+
+void write_ply(const std::string& path, Layout layout, Format format, uint64_t seed, int64_t rows) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr) {
+        throw std::runtime_error("failed to open " + path + " for writing");
+    }
+    try {
+        std::string text = header(layout, format, seed, rows);
+        std::fwrite(text.data(), 1, text.size(), f);
+
+        const std::vector<VertexProperty> properties = vertex_properties(layout);
+        write_rows(f, rows, [&](int64_t begin, int64_t end, std::string& out) {
+            RowEncoder encoder(format, out);
+            encode_vertices(properties, seed, begin, end, encoder);
+        });
+        if (has_faces(layout)) {
+            write_rows(f, rows, [&](int64_t begin, int64_t end, std::string& out) {
+                RowEncoder encoder(format, out);
+                encode_faces(layout, seed, rows, begin, end, encoder);
+            });
+        }
+    } catch (...) {
+        std::fclose(f);
+        throw;
+    }
+    if (std::fclose(f) != 0) {
+        throw std::runtime_error("failed to write " + path);
+    }
+}
+
+void make_directory(const std::string& path) {
+    if (mkdir(path.c_str(), 0777) != 0 && errno != EEXIST) {
+        throw std::runtime_error("failed to create directory " + path);
+    }
+}
+
+struct Options {
+    std::string output_dir;
+    int64_t rows = 100000;
+    uint64_t seed = 0;
+    int64_t tiny_files = 10000;
+    int64_t tiny_rows = 64;
+    bool huge = false;
+    int64_t huge_bytes = 50000000000;
+};
+
+int64_t parse_number(const std::string& arg, size_t prefix_size) {
+    char* end;
+    long long value = std::strtoll(arg.c_str() + prefix_size, &end, 10);
+    if (*end != '\0' || value < 0) {
+        throw std::runtime_error("invalid value in " + arg);
+    }
+    return int64_t(value);
+}
+
+Options parse_options(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--rows=") == 0) {
+            options.rows = std::max<int64_t>(1, parse_number(arg, 7));
+        } else if (arg.compare(0, 7, "--seed=") == 0) {
+            options.seed = uint64_t(parse_number(arg, 7));
+        } else if (arg.compare(0, 13, "--tiny-files=") == 0) {
+            options.tiny_files = parse_number(arg, 13);
+        } else if (arg.compare(0, 12, "--tiny-rows=") == 0) {
+            options.tiny_rows = std::max<int64_t>(1, parse_number(arg, 12));
+        } else if (arg == "--huge") {
+            options.huge = true;
+        } else if (arg.compare(0, 13, "--huge-bytes=") == 0) {
+            options.huge_bytes = parse_number(arg, 13);
+        } else if (arg.compare(0, 2, "--") != 0 && options.output_dir.empty()) {
+            options.output_dir = arg;
+        } else {
+            throw std::runtime_error("unknown argument: " + arg);
+        }
+    }
+    if (options.output_dir.empty()) {
+        throw std::runtime_error("usage: make_corpus OUTPUT_DIR [--rows=N] [--seed=N] [--tiny-files=N] "
+                                 "[--tiny-rows=N] [--huge] [--huge-bytes=N]");
+    }
+    return options;
+}
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+    try {
+        Options options = parse_options(argc, argv);
+        make_directory(options.output_dir);
+
+        // Every layout in every encoding.
+        for (Layout layout : kLayouts) {
+            for (Format format : kFormats) {
+                std::string path = options.output_dir + "/" + layout_label(layout) + "_" + format_label(format) +
+                                   "_" + std::to_string(options.rows) + ".ply";
+                write_ply(path, layout, format, options.seed, options.rows);
+                std::printf("%s\n", path.c_str());
+            }
+        }
+
+        // Many tiny meshes, each with its own seed.
+        if (options.tiny_files > 0) {
+            std::string tiny_dir = options.output_dir + "/tiny";
+            make_directory(tiny_dir);
+            for (int64_t i = 0; i < options.tiny_files; ++i) {
+                char name[48];
+                std::snprintf(name, sizeof(name), "/tri_mesh_le_%06lld.ply", (long long)i);
+                write_ply(tiny_dir + name, Layout::TriMesh, Format::LittleEndian, options.seed + uint64_t(i) + 1,
+                          options.tiny_rows);
+            }
+            std::printf("%s/ (%lld files)\n", tiny_dir.c_str(), (long long)options.tiny_files);
+        }
+
+        // One very large splat file, sized by its body.
+        if (options.huge) {
+            int64_t rows = std::max<int64_t>(1, options.huge_bytes / int64_t(vertex_properties(Layout::Splat).size() * 4));
+            std::string path = options.output_dir + "/huge_splat_le.ply";
+            write_ply(path, Layout::Splat, Format::LittleEndian, options.seed, rows);
+            std::printf("%s\n", path.c_str());
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "make_corpus: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
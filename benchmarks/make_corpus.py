@@ -0,0 +1,166 @@
+"""
+Writes a reproducible corpus of PLY files for benchmarking.
+
+This is the Python entry point of `benchmarks/cpp/make_corpus.cpp` and writes byte-identical files: every
+value is a hash of (seed, stream, row), see the C++ tool for the scheme. The C++ tool is considerably faster,
+use it for the large corpora (`--huge`).
+
+    python benchmarks/make_corpus.py OUTPUT_DIR [--rows N] [--seed N] [--tiny-files N] [--tiny-rows N]
+                                     [--huge] [--huge-bytes N]
+"""
+import argparse
+import os
+
+import numpy as np
+
+MASK = (1 << 64) - 1
+CHUNK_ROWS = 1 << 16
+FACE_SIZE_STREAM = 100
+FACE_CORNER_STREAM = 101
+
+FORMATS = [('ascii', 'ascii'), ('le', 'binary_little_endian'), ('be', 'binary_big_endian')]
+LAYOUTS = ['points', 'splat', 'tri_mesh', 'quad_mesh', 'mixed_mesh']
+SPLAT_PROPERTIES = (
+    ['x', 'y', 'z', 'nx', 'ny', 'nz', 'f_dc_0', 'f_dc_1', 'f_dc_2']
+    + ['f_rest_{}'.format(i) for i in range(45)]
+    + ['opacity', 'scale_0', 'scale_1', 'scale_2', 'rot_0', 'rot_1', 'rot_2', 'rot_3']
+)
+
+
+def hash_rows(seed: int, stream: int, rows: np.ndarray) -> np.ndarray:
+    base = np.uint64((seed * 0x9e3779b97f4a7c15 + stream * 0xd1b54a32d192ed03) & MASK)
+    with np.errstate(over='ignore'):
+        z = rows + base
+        z = (z ^ (z >> np.uint64(30))) * np.uint64(0xbf58476d1ce4e5b9)
+        z = (z ^ (z >> np.uint64(27))) * np.uint64(0x94d049bb133111eb)
+    return z ^ (z >> np.uint64(31))
+
+
+def hash_floats(seed: int, stream: int, rows: np.ndarray) -> np.ndarray:
+    return (hash_rows(seed, stream, rows) >> np.uint64(40)).astype(np.float32) * np.float32(2 ** -23) - np.float32(1)
+
+
+def vertex_properties(layout: str):
+    """List of (name, is_uchar) pairs."""
+    if layout == 'splat':
+        return [(name, False) for name in SPLAT_PROPERTIES]
+    properties = [('x', False), ('y', False), ('z', False)]
+    if layout == 'points':
+        properties += [('red', True), ('green', True), ('blue', True)]
+    return properties
+
+
+def has_faces(layout: str) -> bool:
+    return layout.endswith('_mesh')
+
+
+def header(layout: str, format_name: str, seed: int, rows: int) -> str:
+    lines = ['ply', 'format {} 1.0'.format(format_name), 'comment make_corpus layout={} seed={}'.format(layout, seed),
+             'element vertex {}'.format(rows)]
+    for name, is_uchar in vertex_properties(layout):
+        lines.append('property {} {}'.format('uchar' if is_uchar else 'float', name))
+    if has_faces(layout):
+        lines += ['element face {}'.format(rows), 'property list uchar int vertex_indices']
+    lines.append('end_header')
+    return '\n'.join(lines) + '\n'
+
+
+def encode_vertices(layout: str, label: str, seed: int, rows: np.ndarray) -> bytes:
+    columns = []
+    for stream, (_, is_uchar) in enumerate(vertex_properties(layout)):
+        if is_uchar:
+            columns.append((hash_rows(seed, stream, rows) & np.uint64(0xff)).astype(np.uint8))
+        else:
+            columns.append(hash_floats(seed, stream, rows))
+
+    if label == 'ascii':
+        text = [['%u' % v for v in c.tolist()] if c.dtype == np.uint8 else ['%.9g' % v for v in c.tolist()]
+                for c in columns]
+        return ''.join(' '.join(values) + '\n' for values in zip(*text)).encode()
+
+    order = '<' if label == 'le' else '>'
+    dtype = np.dtype([('p{}'.format(i), 'u1' if c.dtype == np.uint8 else order + 'f4') for i, c in enumerate(columns)])
+    data = np.empty(len(rows), dtype=dtype)
+    for i, c in enumerate(columns):
+        data['p{}'.format(i)] = c
+    return data.tobytes()
+
+
+def encode_faces(layout: str, label: str, seed: int, num_vertices: int, rows: np.ndarray) -> bytes:
+    if layout == 'tri_mesh':
+        sizes = np.full(len(rows), 3, dtype=np.int64)
+    elif layout == 'quad_mesh':
+        sizes = np.full(len(rows), 4, dtype=np.int64)
+    else:
+        sizes = (hash_rows(seed, FACE_SIZE_STREAM, rows) % np.uint64(4)).astype(np.int64) + 3
+    max_size = int(sizes.max()) if len(rows) else 0
+    corners = np.stack([hash_rows(seed, FACE_CORNER_STREAM + j, rows) % np.uint64(num_vertices)
+                        for j in range(max_size)], axis=1).astype(np.int32) if max_size else None
+
+    if label == 'ascii':
+        lines = []
+        for size, face in zip(sizes.tolist(), corners.tolist() if corners is not None else []):
+            lines.append(' '.join(['%u' % size] + ['%d' % v for v in face[:size]]) + '\n')
+        return ''.join(lines).encode()
+
+    # Each face is a count byte followed by its indices.
+    record_sizes = 1 + 4 * sizes
+    offsets = np.concatenate([[0], np.cumsum(record_sizes)[:-1]])
+    out = np.empty(int(record_sizes.sum()), dtype=np.uint8)
+    out[offsets] = sizes.astype(np.uint8)
+    dtype = np.dtype('<i4' if label == 'le' else '>i4')
+    for j in range(max_size):
+        has_corner = sizes > j
+        values = corners[has_corner, j].astype(dtype).view(np.uint8).reshape(-1, 4)
+        positions = offsets[has_corner] + 1 + 4 * j
+        out[positions[:, None] + np.arange(4)] = values
+    return out.tobytes()
+
+
+def write_ply(path: str, layout: str, label: str, format_name: str, seed: int, rows: int):
+    with open(path, 'wb') as f:
+        f.write(header(layout, format_name, seed, rows).encode())
+        for begin in range(0, rows, CHUNK_ROWS):
+            f.write(encode_vertices(layout, label, seed, np.arange(begin, min(rows, begin + CHUNK_ROWS), dtype=np.uint64)))
+        if has_faces(layout):
+            for begin in range(0, rows, CHUNK_ROWS):
+                chunk = np.arange(begin, min(rows, begin + CHUNK_ROWS), dtype=np.uint64)
+                f.write(encode_faces(layout, label, seed, rows, chunk))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('output_dir')
+    parser.add_argument('--rows', type=int, default=100000, help='rows per element in the main corpus')
+    parser.add_argument('--seed', type=int, default=0)
+    parser.add_argument('--tiny-files', type=int, default=10000, help='number of tiny meshes')
+    parser.add_argument('--tiny-rows', type=int, default=64, help='vertices (and faces) per tiny mesh')
+    parser.add_argument('--huge', action='store_true', help='also write one very large splat file')
+    parser.add_argument('--huge-bytes', type=int, default=50000000000, help='body size of the large file')
+    args = parser.parse_args()
+    rows = max(1, args.rows)
+
+    os.makedirs(args.output_dir, exist_ok=True)
+    for layout in LAYOUTS:
+        for label, format_name in FORMATS:
+            path = '{}/{}_{}_{}.ply'.format(args.output_dir, layout, label, rows)
+            write_ply(path, layout, label, format_name, args.seed, rows)
+            print(path)
+
+    if args.tiny_files > 0:
+        tiny_dir = args.output_dir + '/tiny'
+        os.makedirs(tiny_dir, exist_ok=True)
+        for i in range(args.tiny_files):
+            path = '{}/tri_mesh_le_{:06d}.ply'.format(tiny_dir, i)
+            write_ply(path, 'tri_mesh', 'le', 'binary_little_endian', args.seed + i + 1, max(1, args.tiny_rows))
+        print('{}/ ({} files)'.format(tiny_dir, args.tiny_files))
+
+    if args.huge:
+        path = args.output_dir + '/huge_splat_le.ply'
+        write_ply(path, 'splat', 'le', 'binary_little_endian', args.seed,
+                  max(1, args.huge_bytes // (4 * len(SPLAT_PROPERTIES))))
+        print(path)
+
+
+if __name__ == '__main__':
+    main()
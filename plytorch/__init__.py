@@ -1,6 +1,9 @@
 __version__ = "0.1.0"
 
-from .plydata import PLYData, PLYElement
+from .plydata import PLYData, PLYElement, update_property, append
 from .basic_geometry import BasicGeometry, field, vertex_field
 from .point_cloud import PointCloud, Mesh
+from .tar import iter_tar
+from .follow import follow
+from .profiling import stats, set_profiling
 
@@ -117,27 +117,63 @@ class BasicGeometry:
             return dict()
         if isinstance(prop_names, str):
             return {prop_names: t}
+        # Views of the columns of `t`: saving gathers them from `t` in one pass, without copies.
         props = t.unbind(dim=-1)
         return {k: v for k,v in zip(prop_names, props)}
 
     @classmethod
-    def load(cls, path: str):
+    def load(cls, path: str, **kwargs):
         """
         Load geometry from a PLY file.
 
         Parameters
         ----------
-        path : str
-            The file path to load the PLY data from.
+        path : str or file object
+            The file path to load the PLY data from, or a binary file object to read it from.
+        **kwargs
+            Reading options forwarded to `PLYData.load` (e.g. `index_dtype`, `validate_indices`, `weld`,
+            `compute_normals`, `vertex_face_adjacency`, `profile`, `max_memory`, `strategy`, `threads`). Tensors it derives while loading
+            (`PLYData.extras`) are set as attributes of the returned instance, e.g. `mesh.vertex_face_offsets`,
+            as are the `stats` of a profiled load and the read `plan`.
 
         Returns
         -------
         BasicGeometry
             An instance of the geometry loaded from the file.
         """
-        return cls(**cls.from_data(PLYData.load(path)))
+        return cls._from_loaded(PLYData.load(path, **kwargs))
+
+    @classmethod
+    def loads(cls, data, **kwargs):
+        """
+        Load geometry from PLY data held in memory.
+
+        Parameters
+        ----------
+        data : bytes, bytearray, memoryview or any contiguous buffer
+            The contents of a PLY file.
+        **kwargs
+            Reading options, the same as for `load`.
+
+        Returns
+        -------
+        BasicGeometry
+            An instance of the geometry loaded from the data.
+        """
+        return cls._from_loaded(PLYData.loads(data, **kwargs))
 
-    def save(self, path: str):
+    @classmethod
+    def _from_loaded(cls, data: PLYData):
+        geometry = cls(**cls.from_data(data))
+        for name, value in data.extras.items():
+            setattr(geometry, name, value)
+        if data.stats is not None:
+            geometry.stats = data.stats
+        if data.plan is not None:
+            geometry.plan = data.plan
+        return geometry
+
+    def save(self, path: str, **kwargs):
         """
         Save the geometry to a PLY file.
 
@@ -145,8 +181,28 @@ class BasicGeometry:
         ----------
         path : str
             The file path to save the PLY data to.
+        **kwargs
+            Writing options forwarded to `PLYData.save` (e.g. `compress`).
+        """
+        PLYData(**self.to_data()).save(path, **kwargs)
+
+    def dumps(self, out=None, endianness: str = 'native'):
+        """
+        Serialize the geometry as a binary PLY file held in memory, see `PLYData.dumps`.
+
+        Parameters
+        ----------
+        out : bytearray, memoryview or any writable contiguous buffer, optional
+            Buffer to write into instead of returning new bytes.
+        endianness : str
+            Byte order of the data: 'native', 'little' or 'big'.
+
+        Returns
+        -------
+        bytes or int
+            The serialized data or, when `out` is given, the number of bytes written to it.
         """
-        PLYData(**self.to_data()).save(path)
+        return PLYData(**self.to_data()).dumps(out, endianness)
 
     @classmethod
     def from_data(cls, data: PLYData):
@@ -0,0 +1,67 @@
+import os
+import time
+from collections import OrderedDict
+
+import _plytorch_extension as pte
+
+from .plydata import PLYElement
+
+
+def follow(path: str, poll_interval: float = 1.0, timeout=None, batch_rows=None, stop_at_count=False):
+    """
+    Follow a binary PLY file that is still being written, like `tail -f`, yielding the rows of its last element as
+    they are written to it.
+
+    Only whole rows are yielded: a row still being written is left for the next batch. The header is read again every
+    time, so that a row count rewritten in it (e.g. by `plytorch.append`) is picked up. On Linux, the file is watched
+    with inotify, so new rows are yielded as soon as they land; elsewhere it is polled every `poll_interval` seconds.
+    The last element, and every element before it, must have no list properties.
+
+    Parameters
+    ----------
+    path : str
+        The path of the file. If it doesn't exist yet, it is waited for.
+    poll_interval : float, optional
+        How often to check the file for new rows, in seconds, when it can't be watched.
+    timeout : float, optional
+        Stop after this many seconds without new rows. `None` follows the file until the caller stops iterating.
+    batch_rows : int, optional
+        Most rows yielded at once. `None` yields all the rows available.
+    stop_at_count : bool, optional
+        Stop once as many rows have been yielded as the header declares for the element, for writers that write the
+        final count up front.
+
+    Yields
+    ------
+    PLYElement
+        The new rows of the last element, a tensor per property.
+    """
+    max_rows = -1 if batch_rows is None else int(batch_rows)
+    if max_rows == 0:
+        raise ValueError('batch_rows must be positive')
+
+    idle_since = time.monotonic()
+
+    def timed_out():
+        return timeout is not None and time.monotonic() - idle_since >= timeout
+
+    while not os.path.exists(path):
+        if timed_out():
+            return
+        time.sleep(poll_interval)
+
+    follower = pte.PLYFollowIterator(path)
+    while True:
+        properties = follower.read(max_rows)
+        if properties is not None:
+            idle_since = time.monotonic()
+            yield PLYElement(OrderedDict(properties))
+            continue
+        if stop_at_count and 0 < follower.header_count <= follower.rows_read:
+            return
+        if timed_out():
+            return
+        wait = poll_interval
+        if timeout is not None:
+            wait = min(wait, max(timeout - (time.monotonic() - idle_since), 0))
+        follower.wait(wait)
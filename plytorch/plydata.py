@@ -19,8 +19,10 @@ Classes:
     PLYData: Main class for loading, manipulating, and saving PLY files.
 
 Functions:
-    PLYData.load: Loads a PLY file from a file.
+    PLYData.load: Loads a PLY file from a file or a binary file object.
+    PLYData.loads: Loads PLY data from bytes or any other buffer.
     PLYData.save: Saves PLY data to a file.
+    PLYData.dumps: Serializes PLY data to bytes or into a caller-provided buffer.
 
 Example:
     >>> ply_data = PLYData.load('model.ply')
@@ -38,6 +40,46 @@ Example:
 """
 
 
+def _read_options(index_dtype=None, validate_indices=False, weld=None, compute_normals=False,
+                  vertex_face_adjacency=False, profile=False, max_memory=None, strategy='auto', threads=None):
+    options = pte.ReadOptions()
+    if index_dtype is not None:
+        options.index_dtype = str(index_dtype).replace('torch.', '')
+    options.validate_indices = validate_indices
+    if weld is not None:
+        if weld <= 0:
+            raise ValueError('weld must be a positive distance, got {}'.format(weld))
+        options.weld_epsilon = weld
+    options.compute_normals = compute_normals
+    options.vertex_face_adjacency = vertex_face_adjacency
+    options.profile = profile
+    if max_memory is not None:
+        if max_memory <= 0:
+            raise ValueError('max_memory must be a positive number of bytes, got {}'.format(max_memory))
+        options.max_memory = int(max_memory)
+    options.strategy = strategy
+    if threads is not None:
+        if threads <= 0:
+            raise ValueError('threads must be positive, got {}'.format(threads))
+        options.threads = int(threads)
+    return options
+
+
+def _check_endianness(endianness):
+    if endianness not in ('native', 'little', 'big'):
+        raise ValueError("endianness must be 'native', 'little' or 'big', got '{}'".format(endianness))
+    return endianness
+
+
+def _write_property(prop):
+    # Lists of varying length are given as (values, offsets), row i being
+    # values[offsets[i]:offsets[i + 1]].
+    if isinstance(prop, tuple):
+        values, offsets = prop
+        return values.cpu(), offsets.cpu().to(torch.int64).contiguous()
+    return prop.cpu()
+
+
 class PLYElement(OrderedDict):
     __getattr__ = OrderedDict.get
     __setattr__ = OrderedDict.__setitem__
@@ -70,32 +112,276 @@ class PLYData(OrderedDict):
     __setattr__ = OrderedDict.__setitem__
     __delattr__ = OrderedDict.__delitem__
 
+    def __init__(self, *args, **kwargs):
+        super().__init__(*args, **kwargs)
+        # Tensors derived while loading (e.g. vertex-face adjacency). They are not part of the file and are not saved.
+        object.__setattr__(self, 'extras', OrderedDict())
+        # Timings and counters of the load, if it was profiled (see `plytorch.stats`).
+        object.__setattr__(self, 'stats', None)
+        # How the file was read, for loads of files (see `PLYData.load`).
+        object.__setattr__(self, 'plan', None)
+
     @property
     def elements(self):
         return sorted(self.keys())
 
     @staticmethod
-    def load(path: str):
-        if not os.path.isfile(path):
+    def _from_result(result):
+        data = PLYData({name: PLYElement(props) for name, props in result.elements})
+        data.extras.update(result.extras)
+        object.__setattr__(data, 'stats', result.stats)
+        object.__setattr__(data, 'plan', result.plan)
+        return data
+
+    @staticmethod
+    def load(path: str, index_dtype: torch.dtype = None, validate_indices: bool = False, weld: float = None,
+             compute_normals: bool = False, vertex_face_adjacency: bool = False, profile: bool = False,
+             max_memory: int = None, strategy: str = 'auto', threads: int = None):
+        """
+        Load a PLY file.
+
+        Parameters
+        ----------
+        path : str or file object
+            The file path to load the PLY data from, or a binary file object to read it from
+            (anything with a `readinto` method, e.g. an open file or `io.BytesIO`). Pipes and FIFOs
+            are read front to back, skipping data by reading past it; `'-'` reads standard input.
+            gzip and zlib compressed data is recognized and decompressed while reading.
+        index_dtype : torch.dtype, optional
+            `torch.int32` or `torch.int64`. Vertex index lists (`vertex_index`, `vertex_indices`)
+            are converted to this dtype while being extracted. By default the dtype stored in the file is kept.
+        validate_indices : bool
+            Check that vertex index lists only refer to existing vertices, raising an error naming
+            the first offending face otherwise.
+        weld : float, optional
+            Merge duplicated vertices: vertices whose positions fall into the same cell of a grid
+            with this spacing are replaced by the first of them, and vertex index lists are
+            remapped accordingly.
+        compute_normals : bool
+            If the vertex element has no `nx`, `ny`, `nz` properties, compute area-weighted vertex
+            normals from the faces while they are extracted and add them to the vertex element.
+        vertex_face_adjacency : bool
+            Build the faces around every vertex in CSR form and store them in `extras`: the faces
+            of vertex `v` are `extras['vertex_face_ids'][offsets[v]:offsets[v + 1]]` in increasing
+            order, with `offsets = extras['vertex_face_offsets']`. Implies `validate_indices`.
+        profile : bool
+            Time the phases of the load and count the work done, and store the result in `stats` as a
+            dict, see `plytorch.stats`.
+        max_memory : int, optional
+            Most bytes the reader may hold besides the loaded tensors. Fixed-size elements larger than
+            this are loaded a chunk of rows at a time, and elements are decoded one after another.
+            Elements with lists are still loaded whole.
+        strategy : str
+            How to read files: `'buffered'` (one reader, element after element), `'parallel'` (elements
+            decoded at the same time by readers of their own), `'mmap'` (the file is memory-mapped and
+            binary little-endian data extracted in place) or `'stream'` (front to back). `'auto'` picks
+            one from the header, the file size, the filesystem and how much of the file is in the page
+            cache; the choice and its reason end up in `plan`.
+        threads : int, optional
+            Threads the load may use. By default about one per 4 MB of file, up to the number of cores.
+        """
+        options = _read_options(index_dtype=index_dtype, validate_indices=validate_indices, weld=weld,
+                                compute_normals=compute_normals, vertex_face_adjacency=vertex_face_adjacency,
+                                profile=profile, max_memory=max_memory, strategy=strategy, threads=threads)
+        if hasattr(path, 'readinto'):
+            return PLYData._from_result(pte.read_ply_stream(path.readinto, options))
+        # Besides regular files, FIFOs and character devices can be read front to back.
+        if path != '-' and (not os.path.exists(path) or os.path.isdir(path)):
             raise FileNotFoundError('File not found: "{}"'.format(path))
-        return PLYData({name: PLYElement(props) for name, props in pte.read_ply(path)})
+        return PLYData._from_result(pte.read_ply(path, options))
+
+    @staticmethod
+    def loads(data, **kwargs):
+        """
+        Load PLY data held in memory.
+
+        Parameters
+        ----------
+        data : bytes, bytearray, memoryview or any contiguous buffer
+            The contents of a PLY file. Binary data is extracted directly from this buffer,
+            without copying it first.
+        **kwargs
+            Reading options, the same as for `PLYData.load`.
+        """
+        return PLYData._from_result(pte.read_ply_buffer(data, _read_options(**kwargs)))
+
+    def _write_elements(self):
+        # Strided tensors (e.g. the columns of an [N, 3] field) are gathered by the writer as
+        # they are, so they are not made contiguous first.
+        return [
+            (element_name, [
+                (prop_name, _write_property(prop))
+                for prop_name, prop in element.items()
+            ])
+            for element_name, element in self.items()
+        ]
+
+    def save(self, path: str, compress: bool = None, compression_level: int = 6, profile: bool = False,
+             max_memory: int = None, format: str = 'binary', precision: int = None, endianness: str = 'native',
+             list_count_type: str = None, strategy: str = 'auto', sync: bool = False, appendable: bool = False):
+        """
+        Save the data to a PLY file.
 
-    def save(self, path: str):
+        A property is a tensor of one value per row, [N] or [N, 1], or of a list of the same
+        length per row, [N, K]. A list property of varying length, such as the vertex indices of
+        polygon faces, is a (values, offsets) pair of tensors, row i holding
+        values[offsets[i]:offsets[i + 1]] (offsets has N + 1 entries).
+
+        Parameters
+        ----------
+        path : str
+            The file path to save the PLY data to.
+        compress : bool, optional
+            Write blocked gzip (BGZF), which `load` decompresses in parallel and any gzip tool can
+            read. By default, paths ending with `.gz` are compressed.
+        compression_level : int
+            zlib compression level, from 1 (fastest) to 9 (smallest).
+        profile : bool
+            Add the time spent and the bytes written to `plytorch.stats()`.
+        max_memory : int, optional
+            Most bytes to hold while interleaving rows before writing them, 16 MB by default.
+        format : str
+            'binary', or 'ascii' for text, which is larger and slower to write and read but
+            required by some tools.
+        precision : int, optional
+            Significant digits of floating-point values written as text, from 1 to 17. By
+            default, each value gets the fewest digits that read back as the same value.
+        endianness : str
+            Byte order of binary data: 'native' (that of this machine), 'little' or 'big'.
+            Values are byte-swapped while rows are interleaved, at no extra cost.
+        list_count_type : str, optional
+            Type of the lengths of list properties: 'uchar', 'ushort' or 'uint'. By default, the
+            smallest that holds the longest list of each property.
+        strategy : str
+            'buffered' to interleave rows into a buffer written to the file a chunk at a time, 'mmap'
+            to size the file up front and interleave rows straight into a memory mapping of it, in
+            parallel, or 'auto' to map uncompressed binary files of 64 MB or more.
+        sync : bool
+            Return only once the file is on stable storage (fdatasync).
+        appendable : bool
+            Leave room in the header for the row count of the last element to grow, so that rows
+            can later be added to it with `plytorch.append` without rewriting the file.
+        """
         if not os.path.isdir(os.path.dirname(os.path.abspath(path))):
             raise FileNotFoundError("Parent directory does not exist for path: '{}'".format(path))
 
-        pte.write_ply(
-            path, [
-                (element_name, [
-                    (prop_name, prop.cpu().contiguous())
-                    for prop_name, prop in element.items()
-                ])
-                for element_name, element in self.items()
-            ]
-        )
+        options = pte.WriteOptions()
+        options.compress = path.endswith('.gz') if compress is None else compress
+        options.compression_level = compression_level
+        options.profile = profile
+        if max_memory is not None:
+            if max_memory <= 0:
+                raise ValueError('max_memory must be a positive number of bytes, got {}'.format(max_memory))
+            options.max_memory = int(max_memory)
+        if format not in ('binary', 'ascii'):
+            raise ValueError("format must be 'binary' or 'ascii', got '{}'".format(format))
+        options.format = format
+        options.endianness = _check_endianness(endianness)
+        if precision is not None:
+            if not 1 <= precision <= 17:
+                raise ValueError('precision must be between 1 and 17, got {}'.format(precision))
+            options.precision = int(precision)
+        if list_count_type is not None:
+            if list_count_type not in ('uchar', 'ushort', 'uint'):
+                raise ValueError("list_count_type must be 'uchar', 'ushort' or 'uint', got '{}'".format(
+                    list_count_type))
+            options.list_count_type = list_count_type
+        if strategy not in ('auto', 'buffered', 'mmap'):
+            raise ValueError("strategy must be 'auto', 'buffered' or 'mmap', got '{}'".format(strategy))
+        options.strategy = strategy
+        options.sync = sync
+        options.appendable = appendable
+        pte.write_ply(path, self._write_elements(), options)
+
+    def nbytes(self, endianness: str = 'native'):
+        """
+        Size in bytes of the data once serialized as binary with `save` or `dumps`.
+        """
+        return pte.ply_size(self._write_elements(), _check_endianness(endianness))
+
+    def dumps(self, out=None, endianness: str = 'native'):
+        """
+        Serialize the data as a binary PLY file held in memory.
+
+        The exact output size is computed up front, so the output is allocated once and the
+        properties are interleaved directly into it.
+
+        Parameters
+        ----------
+        out : bytearray, memoryview or any writable contiguous buffer, optional
+            Buffer to write into, of at least `nbytes()` bytes.
+        endianness : str
+            Byte order of the data: 'native', 'little' or 'big'.
+
+        Returns
+        -------
+        bytes or int
+            The serialized data or, when `out` is given, the number of bytes written to it.
+        """
+        endianness = _check_endianness(endianness)
+        if out is not None:
+            return pte.dumps_ply_into(self._write_elements(), out, endianness)
+        return pte.dumps_ply(self._write_elements(), endianness)
 
     def __repr__(self):
         repr_str = 'PLYData ({} elements):\n'.format(len(self))
         for key, value in self.items():
             repr_str += '  {}: {}\n'.format(key, str(value))
         return repr_str
+
+
+def update_property(path: str, element: str, name: str, values: torch.Tensor):
+    """
+    Overwrite one property of a binary PLY file in place, without rewriting the rest of the file.
+
+    Only the bytes of that property are written, straight into the rows of the element, so
+    recomputing e.g. the colors or a confidence of a large point cloud costs a fraction of saving it
+    again. Big-endian files are byte-swapped on the way.
+
+    Parameters
+    ----------
+    path : str
+        The binary PLY file to update. Compressed and ASCII files can't be updated in place.
+    element : str
+        The element of the property, e.g. 'vertex'. Its rows must be of fixed size (no lists), and so
+        must those of every element before it.
+    name : str
+        The property, e.g. 'confidence'. It must already exist and be a scalar property.
+    values : torch.Tensor
+        One value per row of the element, [N] or [N, 1], of the type of the property in the file
+        (e.g. torch.uint8 for 'uchar', torch.float32 for 'float').
+    """
+    if not os.path.isfile(path):
+        raise FileNotFoundError('File not found: "{}"'.format(path))
+    pte.update_property(path, element, name, values.cpu())
+
+
+def append(path: str, element: str, properties):
+    """
+    Append rows to the last element of a PLY file in place, without reading or rewriting the rows
+    already in it.
+
+    The new rows are written at the end of the element's data, then its row count is rewritten in
+    the header, so the cost only depends on the number of new rows. Save the file with
+    `appendable=True` to leave room in the header for the count to grow; otherwise it can only grow
+    as long as it keeps as many digits.
+
+    Parameters
+    ----------
+    path : str
+        The PLY file, binary or ASCII. Compressed files can't be appended to in place.
+    element : str
+        The element to extend, which must be the last one of the file (e.g. 'vertex' for a point
+        cloud).
+    properties : dict
+        The new rows: a tensor per property of the element, or a (values, offsets) pair for list
+        properties of varying length (see `PLYData.save`), of the types declared in the file.
+
+    Returns
+    -------
+    int
+        The number of rows of the element after appending.
+    """
+    if not os.path.isfile(path):
+        raise FileNotFoundError('File not found: "{}"'.format(path))
+    return pte.append_ply(path, element, [(name, _write_property(prop)) for name, prop in properties.items()])
@@ -0,0 +1,44 @@
+import _plytorch_extension as pte
+
+
+def stats(reset: bool = False) -> dict:
+    """
+    Timings and counters summed over every profiled load and save so far.
+
+    Loads and saves called with `profile=True` are profiled, and all of them, including `dumps`, while
+    profiling is enabled with `set_profiling`. Times are in nanoseconds, split into phases that don't
+    overlap:
+
+    - `header_ns`: parsing headers.
+    - `read_ns`: reading (and decompressing) data.
+    - `load_ns`, `swap_ns`, `list_ns`: loading fixed-size elements (including ASCII parsing),
+      byte swapping big-endian ones, and loading elements with list properties.
+    - `extract_ns`, `convert_ns`, `index_ns`: copying values into tensors, converting them to another
+      type, and converting or validating vertex index lists.
+    - `allocate_ns`: allocating tensors.
+    - `postprocess_ns`: welding vertices, computing normals and adjacency.
+    - `interleave_ns`, `compress_ns`, `write_ns`: laying out rows, compressing and writing when saving.
+
+    `total_ns` is the wall time of the calls, from which the phases may differ as elements are
+    loaded on several threads. The counters are `calls`, `bytes_read`, `refills` (reads into the
+    read buffer), `memmoves` and `memmove_bytes` (partial values moved to its start), `conversions`
+    (values converted to another type), `allocations` and `allocated_bytes` (tensors and reader buffers),
+    `copied_bytes`, `bytes_written`, and `buffered_reads`, `parallel_reads`, `mapped_reads` and
+    `stream_reads`, the files read with each strategy (see `PLYData.plan`), and `mapped_writes`, the
+    files saved through a memory mapping. `peak_transient_bytes` is
+    the most memory any one call held besides its tensors.
+
+    Parameters
+    ----------
+    reset : bool
+        Start again from zero after returning the current totals.
+    """
+    return pte.stats(reset)
+
+
+def set_profiling(enabled: bool = True):
+    """
+    Profile every load and save, adding their timings and counters to `stats()`. The overhead is a couple
+    of clock reads per 128 KB read and per element.
+    """
+    pte.set_profiling(enabled)
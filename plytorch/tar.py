@@ -0,0 +1,53 @@
+import os
+
+import _plytorch_extension as pte
+
+from .plydata import PLYData, _read_options
+
+
+def iter_tar(path: str, select='*.ply', geometry=None, **kwargs):
+    """
+    Iterate over the PLY files stored in a tar archive (e.g. a WebDataset shard).
+
+    The archive, which may be gzip compressed, is read front to back in a single pass. Members are
+    decoded straight from memory, without being extracted, and the next member is read in the
+    background while the current one is being decoded.
+
+    Parameters
+    ----------
+    path : str
+        The path of the tar archive.
+    select : str, list of str or callable, optional
+        Which members to load. Shell-style patterns (`*`, `?`) matched against member names; members
+        that match none of them are skipped without being read into memory. A callable is given each
+        member name and returns whether to decode it. `None` selects all members.
+    geometry : type, optional
+        A `BasicGeometry` subclass (e.g. `Mesh`) to build from each member instead of `PLYData`.
+    **kwargs
+        Reading options, the same as for `PLYData.load`.
+
+    Yields
+    ------
+    tuple of (str, PLYData or BasicGeometry)
+        The member name and its contents.
+    """
+    if not os.path.isfile(path):
+        raise FileNotFoundError('File not found: "{}"'.format(path))
+
+    if select is None or callable(select):
+        patterns = []
+    elif isinstance(select, str):
+        patterns = [select]
+    else:
+        patterns = list(select)
+
+    options = _read_options(**kwargs)
+    members = pte.TarPLYIterator(path, patterns)
+    while True:
+        name = members.next()
+        if name is None:
+            return
+        if callable(select) and not select(name):
+            continue
+        data = PLYData._from_result(members.read(options))
+        yield name, data if geometry is None else geometry._from_loaded(data)
@@ -0,0 +1,428 @@
+#include "gzip_io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+
+#include <zlib.h>
+
+#include "parallel.h"
+
+
+namespace {
+
+// Input buffered for streaming decompression.
+constexpr size_t kInflateInputSize = 256 * 1024;
+
+// BGZF blocks are at most 64 KB. Limiting their data to this much keeps even
+// incompressible blocks, stored as they are, within that.
+constexpr size_t kBlockMaxSize = 0x10000;
+constexpr size_t kBlockDataSize = 0xff00;
+constexpr size_t kBlockHeaderSize = 18;
+constexpr size_t kBlockFooterSize = 8;
+
+// BGZF blocks decompressed or compressed together, spread over the threads.
+constexpr size_t kBlocksPerBatch = 256;
+
+// The empty block BGZF files end with.
+const uint8_t kEndOfFileBlock[28] = {
+    0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+    0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+inline uint32_t read_le16(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8);
+}
+
+inline uint32_t read_le32(const uint8_t* p) {
+    return read_le16(p) | (read_le16(p + 2) << 16);
+}
+
+inline void write_le16(uint8_t* p, uint32_t value) {
+    p[0] = uint8_t(value);
+    p[1] = uint8_t(value >> 8);
+}
+
+inline void write_le32(uint8_t* p, uint32_t value) {
+    write_le16(p, value);
+    write_le16(p + 2, value >> 16);
+}
+
+// Total size of the BGZF block starting with `header` (kBlockHeaderSize
+// bytes), or 0 if it doesn't start one.
+size_t bgzf_block_size(const uint8_t* header) {
+    if (header[0] != 0x1f || header[1] != 0x8b || header[2] != 8 || (header[3] & 4) == 0) {
+        return 0;
+    }
+    if (read_le16(header + 10) != 6 || header[12] != 'B' || header[13] != 'C' || read_le16(header + 14) != 2) {
+        return 0;
+    }
+    return size_t(read_le16(header + 16)) + 1;
+}
+
+// Reads exactly `size` bytes unless the data ends first.
+size_t read_fully(miniply::PLYSource& source, void* dest, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+        size_t n = source.read(static_cast<uint8_t*>(dest) + total, size - total);
+        if (n == 0) {
+            break;
+        }
+        total += n;
+    }
+    return total;
+}
+
+
+// Replays bytes already taken from a source that can't seek back to them.
+class PrefixedSource : public miniply::PLYSource {
+public:
+    PrefixedSource(std::vector<uint8_t> prefix, std::unique_ptr<miniply::PLYSource> source) :
+        m_prefix(std::move(prefix)), m_source(std::move(source)) {}
+
+    size_t read(void* dest, size_t size) override {
+        size_t from_prefix = std::min(size, m_prefix.size() - m_prefixPos);
+        std::memcpy(dest, m_prefix.data() + m_prefixPos, from_prefix);
+        m_prefixPos += from_prefix;
+        if (from_prefix == size) {
+            return size;
+        }
+        return from_prefix + m_source->read(static_cast<uint8_t*>(dest) + from_prefix, size - from_prefix);
+    }
+
+    bool seek(int64_t) override { return false; }
+    bool seekable() const override { return false; }
+
+private:
+    std::vector<uint8_t> m_prefix;
+    size_t m_prefixPos = 0;
+    std::unique_ptr<miniply::PLYSource> m_source;
+};
+
+
+// Decompresses a gzip or zlib stream, including gzip files of several members.
+class InflateSource : public miniply::PLYSource {
+public:
+    explicit InflateSource(std::unique_ptr<miniply::PLYSource> input) :
+        m_input(std::move(input)), m_inputBuffer(kInflateInputSize) {
+        std::memset(&m_stream, 0, sizeof(m_stream));
+        // 15 + 32: the largest window, with gzip or zlib headers detected automatically.
+        m_failed = inflateInit2(&m_stream, 15 + 32) != Z_OK;
+    }
+
+    ~InflateSource() override {
+        inflateEnd(&m_stream);
+    }
+
+    size_t read(void* dest, size_t size) override {
+        size = std::min<size_t>(size, UINT_MAX);
+        m_stream.next_out = static_cast<Bytef*>(dest);
+        m_stream.avail_out = uInt(size);
+
+        while (m_stream.avail_out > 0 && !m_failed) {
+            if (m_stream.avail_in == 0 && !m_inputDone) {
+                size_t n = m_input->read(m_inputBuffer.data(), m_inputBuffer.size());
+                m_inputDone = n < m_inputBuffer.size();
+                m_stream.next_in = m_inputBuffer.data();
+                m_stream.avail_in = uInt(n);
+            }
+            if (m_stream.avail_in == 0) {
+                break;
+            }
+            if (m_memberDone) {
+                // Another gzip member may follow; anything else is trailing garbage.
+                if (m_stream.next_in[0] != 0x1f) {
+                    break;
+                }
+                inflateReset(&m_stream);
+                m_memberDone = false;
+            }
+
+            int ret = inflate(&m_stream, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END) {
+                m_memberDone = true;
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                m_failed = true;
+            }
+        }
+        return size - m_stream.avail_out;
+    }
+
+    bool seek(int64_t) override { return false; }
+    bool seekable() const override { return false; }
+
+private:
+    std::unique_ptr<miniply::PLYSource> m_input;
+    std::vector<uint8_t> m_inputBuffer;
+    z_stream m_stream;
+    bool m_inputDone = false;
+    bool m_memberDone = false;
+    bool m_failed = false;
+};
+
+
+// Decompresses BGZF: batches of blocks are decompressed in parallel on a
+// background thread while the previous batch is being consumed, on as many
+// threads as the reading thread may use when it asks for the batch. When
+// limited to one thread, batches are decompressed as they are needed instead.
+// The input is only ever read on the thread reading from this source, as it
+// may not be safe to use from others (e.g. a Python callable, which needs the
+// GIL).
+class BlockedInflateSource : public miniply::PLYSource {
+public:
+    explicit BlockedInflateSource(std::unique_ptr<miniply::PLYSource> input) : m_input(std::move(input)) {
+        m_next = inflate_async(read_blocks(*m_input));
+    }
+
+    ~BlockedInflateSource() override {
+        if (m_next.valid()) {
+            m_next.wait();
+        }
+    }
+
+    size_t read(void* dest, size_t size) override {
+        size_t total = 0;
+        while (total < size) {
+            if (m_pos == m_current.data.size()) {
+                if (!m_next.valid()) {
+                    break;
+                }
+                // The next blocks are read while the current ones are inflated.
+                Blocks blocks;
+                if (!m_inputDone) {
+                    blocks = read_blocks(*m_input);
+                }
+                m_current = m_next.get();
+                m_pos = 0;
+                if (!m_current.last) {
+                    m_next = inflate_async(std::move(blocks));
+                }
+                continue;
+            }
+            size_t n = std::min(size - total, m_current.data.size() - m_pos);
+            std::memcpy(static_cast<uint8_t*>(dest) + total, m_current.data.data() + m_pos, n);
+            m_pos += n;
+            total += n;
+        }
+        return total;
+    }
+
+    bool seek(int64_t) override { return false; }
+    bool seekable() const override { return false; }
+
+private:
+    struct Batch {
+        std::vector<uint8_t> data;
+        bool last = false;  // No more batches follow, because the data ended or is corrupt.
+    };
+
+    // Compressed blocks of a batch, and where their data goes in it.
+    struct Blocks {
+        std::vector<std::vector<uint8_t>> blocks;
+        std::vector<size_t> offsets = std::vector<size_t>(1, 0);
+        bool last = false;  // The data ends with these blocks, or is corrupt after them.
+    };
+
+    Blocks read_blocks(miniply::PLYSource& input) {
+        Blocks blocks;
+        while (blocks.blocks.size() < kBlocksPerBatch) {
+            uint8_t header[kBlockHeaderSize];
+            size_t n = read_fully(input, header, kBlockHeaderSize);
+            size_t block_size = (n == kBlockHeaderSize) ? bgzf_block_size(header) : 0;
+            if (block_size < kBlockHeaderSize + kBlockFooterSize) {
+                blocks.last = true;
+                break;
+            }
+            std::vector<uint8_t> block(block_size);
+            std::memcpy(block.data(), header, kBlockHeaderSize);
+            if (read_fully(input, block.data() + kBlockHeaderSize, block_size - kBlockHeaderSize) !=
+                block_size - kBlockHeaderSize) {
+                blocks.last = true;
+                break;
+            }
+            blocks.offsets.push_back(blocks.offsets.back() + read_le32(block.data() + block_size - 4));
+            blocks.blocks.push_back(std::move(block));
+        }
+        m_inputDone = blocks.last;
+        return blocks;
+    }
+
+    // The thread limit is thread-local, so it is handed on to the thread that
+    // inflates the blocks.
+    static std::future<Batch> inflate_async(Blocks blocks) {
+        const int64_t threads = worker_threads_here();
+        return std::async(threads > 1 ? std::launch::async : std::launch::deferred, inflate_batch, std::move(blocks),
+                          threads);
+    }
+
+    static Batch inflate_batch(Blocks input, int64_t threads) {
+        ScopedWorkerThreadLimit limit(threads);
+        const std::vector<std::vector<uint8_t>>& blocks = input.blocks;
+        const std::vector<size_t>& offsets = input.offsets;
+        Batch batch;
+        batch.last = input.last;
+        batch.data.resize(offsets.back());
+        std::atomic<size_t> failed_at(blocks.size());
+        parallel_for(0, int64_t(blocks.size()), 1, [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; ++i) {
+                if (!inflate_block(blocks[i], batch.data.data() + offsets[i], offsets[i + 1] - offsets[i])) {
+                    size_t expected = failed_at.load();
+                    while (size_t(i) < expected && !failed_at.compare_exchange_weak(expected, size_t(i))) {
+                    }
+                }
+            }
+        });
+        if (failed_at.load() != blocks.size()) {
+            // Hand out what was good, then stop.
+            batch.data.resize(offsets[failed_at.load()]);
+            batch.last = true;
+        }
+        return batch;
+    }
+
+    static bool inflate_block(const std::vector<uint8_t>& block, uint8_t* dest, size_t size) {
+        z_stream stream;
+        std::memset(&stream, 0, sizeof(stream));
+        if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+            return false;
+        }
+        stream.next_in = const_cast<Bytef*>(block.data());
+        stream.avail_in = uInt(block.size());
+        stream.next_out = dest;
+        stream.avail_out = uInt(size);
+        int ret = inflate(&stream, Z_FINISH);
+        bool ok = ret == Z_STREAM_END && stream.avail_out == 0;
+        inflateEnd(&stream);
+        return ok;
+    }
+
+    std::unique_ptr<miniply::PLYSource> m_input;
+    std::future<Batch> m_next;
+    Batch m_current;
+    size_t m_pos = 0;
+    bool m_inputDone = false;
+};
+
+
+// Compresses `size` (at most kBlockDataSize) bytes into one BGZF block.
+std::vector<uint8_t> compress_block(const char* data, size_t size, int level) {
+    std::vector<uint8_t> block(kBlockMaxSize);
+    size_t compressed_size = 0;
+    for (int attempt_level : {level, 0}) {
+        z_stream stream;
+        std::memset(&stream, 0, sizeof(stream));
+        // Raw deflate, the gzip header and footer are written here.
+        if (deflateInit2(&stream, attempt_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("failed to initialize gzip compression");
+        }
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream.avail_in = uInt(size);
+        stream.next_out = block.data() + kBlockHeaderSize;
+        stream.avail_out = uInt(kBlockMaxSize - kBlockHeaderSize - kBlockFooterSize);
+        int ret = deflate(&stream, Z_FINISH);
+        compressed_size = stream.total_out;
+        deflateEnd(&stream);
+        if (ret == Z_STREAM_END) {
+            break;
+        }
+        // Didn't fit: store the data uncompressed instead.
+        compressed_size = 0;
+    }
+    if (compressed_size == 0 && size != 0) {
+        throw std::runtime_error("failed to compress gzip block");
+    }
+
+    size_t block_size = kBlockHeaderSize + compressed_size + kBlockFooterSize;
+    std::memcpy(block.data(), kEndOfFileBlock, kBlockHeaderSize);
+    write_le16(block.data() + 16, uint32_t(block_size - 1));
+    uint32_t crc = uint32_t(crc32(0, reinterpret_cast<const Bytef*>(data), uInt(size)));
+    write_le32(block.data() + kBlockHeaderSize + compressed_size, crc);
+    write_le32(block.data() + kBlockHeaderSize + compressed_size + 4, uint32_t(size));
+    block.resize(block_size);
+    return block;
+}
+
+} // namespace
+
+
+bool is_gzip(const uint8_t* data, size_t size) {
+    return size >= 2 && data[0] == 0x1f && data[1] == 0x8b;
+}
+
+bool is_compressed(const uint8_t* data, size_t size) {
+    if (size < 2) {
+        return false;
+    }
+    if (is_gzip(data, size)) {
+        return true;
+    }
+    // zlib: deflate with a window of at most 32 KB, and a header checksum.
+    return (data[0] & 0x0f) == 8 && (data[0] >> 4) <= 7 && ((uint32_t(data[0]) << 8) | data[1]) % 31 == 0;
+}
+
+std::unique_ptr<miniply::PLYSource> open_decompressed(std::unique_ptr<miniply::PLYSource> source, bool detect_zlib) {
+    if (source == nullptr) {
+        return nullptr;
+    }
+
+    std::vector<uint8_t> prefix(kBlockHeaderSize);
+    prefix.resize(read_fully(*source, prefix.data(), prefix.size()));
+    bool compressed = detect_zlib ? is_compressed(prefix.data(), prefix.size()) : is_gzip(prefix.data(), prefix.size());
+    bool blocked = compressed && prefix.size() == kBlockHeaderSize && bgzf_block_size(prefix.data()) != 0;
+
+    std::unique_ptr<miniply::PLYSource> input;
+    if (source->seekable() && source->seek(0)) {
+        if (!compressed) {
+            return source;
+        }
+        input = std::move(source);
+    } else {
+        input = std::make_unique<PrefixedSource>(std::move(prefix), std::move(source));
+        if (!compressed) {
+            return input;
+        }
+    }
+
+    if (blocked) {
+        return std::make_unique<BlockedInflateSource>(std::move(input));
+    }
+    return std::make_unique<InflateSource>(std::move(input));
+}
+
+
+BlockedGzipWriter::BlockedGzipWriter(std::ostream& out, int level) : m_out(out), m_level(level) {}
+
+void BlockedGzipWriter::write(const char* data, size_t size) {
+    m_buffer.insert(m_buffer.end(), data, data + size);
+    if (m_buffer.size() >= kBlocksPerBatch * kBlockDataSize) {
+        compress_buffered();
+    }
+}
+
+void BlockedGzipWriter::finish() {
+    compress_buffered();
+    if (!m_buffer.empty()) {
+        std::vector<uint8_t> block = compress_block(m_buffer.data(), m_buffer.size(), m_level);
+        m_out.write(reinterpret_cast<const char*>(block.data()), block.size());
+        m_buffer.clear();
+    }
+    m_out.write(reinterpret_cast<const char*>(kEndOfFileBlock), sizeof(kEndOfFileBlock));
+}
+
+void BlockedGzipWriter::compress_buffered() {
+    // Only full blocks; the remainder waits for more data or `finish`.
+    size_t num_blocks = m_buffer.size() / kBlockDataSize;
+    std::vector<std::vector<uint8_t>> blocks(num_blocks);
+    parallel_for(0, int64_t(num_blocks), 1, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            blocks[i] = compress_block(m_buffer.data() + i * kBlockDataSize, kBlockDataSize, m_level);
+        }
+    });
+    for (const std::vector<uint8_t>& block : blocks) {
+        m_out.write(reinterpret_cast<const char*>(block.data()), block.size());
+    }
+    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + num_blocks * kBlockDataSize);
+}
@@ -0,0 +1,51 @@
+#ifndef PLYTORCH_GZIP_IO_H
+#define PLYTORCH_GZIP_IO_H
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "miniply.h"
+
+
+// Whether `data` (at least its first two bytes) starts a gzip stream.
+bool is_gzip(const uint8_t* data, size_t size);
+
+// Whether `data` (at least its first two bytes) starts a gzip or zlib stream.
+// A zlib header is two bytes with a checksum that one pair of bytes in 31
+// passes, so this only tells zlib apart from data known to start otherwise,
+// like PLY data ("ply").
+bool is_compressed(const uint8_t* data, size_t size);
+
+// Wraps `source` so that gzip or zlib compressed data is decompressed on the
+// fly; anything else is passed through. Compressed data is read front to
+// back. Blocked gzip (BGZF) blocks are decompressed in parallel, a batch
+// ahead of the parser. Without `detect_zlib`, only gzip is detected, for data
+// that may start with anything (e.g. a tar archive, with a member name).
+// Returns nullptr if `source` is.
+std::unique_ptr<miniply::PLYSource> open_decompressed(std::unique_ptr<miniply::PLYSource> source,
+                                                      bool detect_zlib = true);
+
+// Writes blocked gzip (BGZF): gzip members of at most 64 KB of data, each
+// recording its compressed size, so that readers can find and decompress
+// them in parallel. Any gzip decoder reads the result as a single stream.
+// Blocks are compressed in parallel, a batch at a time.
+class BlockedGzipWriter {
+public:
+    BlockedGzipWriter(std::ostream& out, int level);
+
+    void write(const char* data, size_t size);
+
+    // Compresses whatever is still buffered and writes the end-of-file block.
+    void finish();
+
+private:
+    void compress_buffered();
+
+    std::ostream& m_out;
+    int m_level;
+    std::vector<char> m_buffer;
+};
+
+#endif // PLYTORCH_GZIP_IO_H
@@ -1,20 +1,50 @@
+#include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <limits>
 #include <string>
 #include <stdexcept>
+#include <tuple>
 
+#include <deque>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <variant>
 
 #include <torch/extension.h>
+#include <ATen/Parallel.h>
+#include <ATen/ThreadLocalState.h>
+#include <ATen/record_function.h>
 #include <pybind11/eval.h>
 
 #include "miniply.h"
+#include "gzip_io.h"
+#include "mesh_ops.h"
+#include "parallel.h"
+#include "ply_edit.h"
+#include "ply_follow.h"
+#include "ply_stats.h"
+#include "ply_writer.h"
+#include "read_plan.h"
+#include "tar_reader.h"
 
 
 using namespace miniply;
 using PropertiesType = std::vector<std::pair<std::string, torch::Tensor>>;
 using ElementsType = std::vector<std::pair<std::string, PropertiesType>>;
 
+// A property to write: a tensor of one value per row, or of one list of the
+// same length per row, or a list property of varying length given as
+// (values, offsets), row i holding values[offsets[i]:offsets[i + 1]].
+using RaggedList = std::pair<torch::Tensor, torch::Tensor>;
+using WritePropertyData = std::variant<torch::Tensor, RaggedList>;
+using WriteElementsType = std::vector<std::pair<std::string, std::vector<std::pair<std::string, WritePropertyData>>>>;
+
 
 const std::unordered_map<PLYPropertyType, torch::ScalarType> ply_to_torch_dtype = {
     {PLYPropertyType::Char, torch::kByte},
@@ -77,12 +107,598 @@ uint32_t get_torch_dtype_size(torch::ScalarType t) {
     }
 }
 
-std::pair<std::string, PropertiesType> read_ply_element(miniply::PLYReader& reader, int element_idx) {
+struct ReadOptions {
+    // Type vertex index lists are extracted as ("int32" or "int64"). Empty keeps the type stored in the file.
+    std::string index_dtype;
+    // Check that every vertex index list entry refers to an existing vertex.
+    bool validate_indices = false;
+    // Merge vertices falling into the same cell of a grid with this spacing. Zero disables welding.
+    double weld_epsilon = 0.0;
+    // Compute area-weighted vertex normals (nx, ny, nz) from the faces if the vertex element has none.
+    bool compute_normals = false;
+    // Build the faces around every vertex in CSR form (vertex_face_offsets, vertex_face_ids).
+    bool vertex_face_adjacency = false;
+    // Time the phases of the read and count the work done, see PLYStats. Also on for every read
+    // while profiling is enabled globally.
+    bool profile = false;
+    // Most bytes the readers may hold besides the output tensors, or zero for no limit. Fixed-size
+    // elements larger than this are loaded a chunk of rows at a time, and elements are decoded one
+    // after another unless they are used in place. Variable-size elements are still loaded whole.
+    int64_t max_memory = 0;
+    // How files are read: "auto" (picked from the header and the storage), "buffered", "parallel",
+    // "mmap" or "stream", see ReadStrategy.
+    std::string strategy = "auto";
+    // Threads the read may use, 0 to pick a number from the size of the file.
+    int64_t threads = 0;
+
+    bool needs_vertex_info() const {
+        return weld_epsilon > 0.0 || compute_normals;
+    }
+};
+
+struct ReadResult {
+    ElementsType elements;
+    // Data derived from the elements on request, e.g. vertex-face adjacency.
+    PropertiesType extras;
+    // Set if the read was profiled.
+    std::optional<PLYStats> stats;
+    // How a file was read, for reads of files.
+    std::optional<ReadPlan> plan;
+};
+
+// Collects the stats of one read, if it is profiled. Each reader gets stats of
+// its own, as the readers of one read may run on different threads.
+class ReadProfiler {
+public:
+    explicit ReadProfiler(const ReadOptions& options) :
+        m_enabled(options.profile || profiling_enabled()), m_start(std::chrono::steady_clock::now()) {}
+
+    bool enabled() const {
+        return m_enabled;
+    }
+
+    // Stats for a new reader to fill in, or nullptr if not profiling.
+    miniply::PLYReaderStats* reader_stats() {
+        if (!m_enabled) {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return &m_readerStats.emplace_back();
+    }
+
+    void add(const PLYStats& stats) {
+        if (m_enabled) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.add(stats);
+        }
+    }
+
+    // Totals of the read, which are also added to the global stats. To be
+    // called once all readers are done.
+    std::optional<PLYStats> finish() {
+        if (!m_enabled) {
+            return std::nullopt;
+        }
+        PLYStats total = m_stats;
+        for (const miniply::PLYReaderStats& reader : m_readerStats) {
+            total.add(reader);
+        }
+        total.calls = 1;
+        total.total_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - m_start).count();
+        add_global_stats(total);
+        return total;
+    }
+
+private:
+    bool m_enabled;
+    std::chrono::steady_clock::time_point m_start;
+    std::mutex m_mutex;
+    std::deque<miniply::PLYReaderStats> m_readerStats;
+    PLYStats m_stats;
+};
+
+// What faces need to know about the vertex element.
+struct VertexInfo {
+    torch::Tensor remap;      // New index of every original vertex, when welding.
+    torch::Tensor positions;  // Float [num_vertices, 3] positions after welding, when computing normals.
+    int64_t num_vertices = 0; // After welding.
+};
+
+// State shared by the elements of one `read_ply` call, which may be decoded on different threads.
+struct ReadState {
+    ReadState() : vertex_info_ready(vertex_info.get_future().share()) {}
+
+    // Published once the vertex element is decoded.
+    std::promise<VertexInfo> vertex_info;
+    std::shared_future<VertexInfo> vertex_info_ready;
+
+    // Derived from the faces by whichever thread extracts them.
+    std::mutex faces_mutex;
+    torch::Tensor vertex_normals;
+    torch::Tensor vertex_face_offsets;
+    torch::Tensor vertex_face_ids;
+
+    ReadProfiler* profiler = nullptr;
+};
+
+// An uninitialized CPU tensor, its allocation counted in `stats` unless that is null.
+torch::Tensor allocate_tensor(at::IntArrayRef sizes, torch::ScalarType dtype, PLYStats* stats) {
+    PLYStatsTimer timer(stats, &PLYStats::allocate_ns);
+    torch::Tensor result = torch::empty(sizes, at::TensorOptions().dtype(dtype).device(torch::kCPU));
+    if (stats != nullptr) {
+        stats->allocations++;
+        stats->allocated_bytes += int64_t(result.nbytes());
+    }
+    return result;
+}
+
+// Everything done to a vertex index list besides converting it to the dtype of its tensor.
+struct IndexListPass {
+    int64_t num_vertices = 0;                    // Number of vertices in the file.
+    bool validate = false;
+    const int64_t* remap = nullptr;              // Replace every index by its entry here.
+    VertexNormalAccumulator* normals = nullptr;  // Add the faces to these normals.
+};
+
+// Index lists are converted in blocks of this many rows, small enough for the
+// converted block to still be in cache when its normals are accumulated.
+constexpr int64_t kIndexRowsPerPass = 4096;
+
+int64_t index_list_blocks(int64_t num_rows) {
+    return std::max<int64_t>(1, std::min(num_rows / kIndexRowsPerPass, worker_threads_here()));
+}
+
+torch::ScalarType get_index_dtype(const std::string& name) {
+    if (name == "int32") {
+        return torch::kInt32;
+    } else if (name == "int64") {
+        return torch::kInt64;
+    }
+    throw std::runtime_error("unsupported index dtype '" + name + "', expected int32 or int64");
+}
+
+bool is_index_property(const PLYProperty& property) {
+    return (property.countType != PLYPropertyType::None) &&
+           (property.name == "vertex_index" || property.name == "vertex_indices");
+}
+
+// Converts `n` indices while keeping track of their range. Plain min/max
+// reductions so that the compiler vectorizes the whole loop. With a `remap`
+// table every index is also replaced by its entry there; out of range indices
+// are clamped for the lookup and reported by the caller afterwards.
+template <class Src, class Dst>
+void convert_indices(const Src* src, Dst* dst, size_t n, const int64_t* remap, int64_t num_vertices,
+                     int64_t& lo, int64_t& hi) {
+    Src min_value = std::numeric_limits<Src>::max();
+    Src max_value = std::numeric_limits<Src>::lowest();
+    if (remap == nullptr) {
+        for (size_t i = 0; i != n; ++i) {
+            Src value = src[i];
+            min_value = std::min(min_value, value);
+            max_value = std::max(max_value, value);
+            dst[i] = static_cast<Dst>(value);
+        }
+    } else {
+        const int64_t last = num_vertices - 1;
+        for (size_t i = 0; i != n; ++i) {
+            Src value = src[i];
+            min_value = std::min(min_value, value);
+            max_value = std::max(max_value, value);
+            dst[i] = static_cast<Dst>(remap[std::min(std::max(int64_t(value), int64_t(0)), last)]);
+        }
+    }
+    lo = min_value;
+    hi = max_value;
+}
+
+// Converts `num_rows` rows of `row_size` indices, one block of rows per
+// thread. Block `b` accumulates its normals into buffer `b`.
+template <class Src, class Dst>
+void convert_index_rows(const Src* src, Dst* dst, int64_t num_rows, uint32_t row_size, const IndexListPass& pass,
+                        int64_t& lo, int64_t& hi) {
+    int64_t num_blocks = (pass.normals != nullptr) ? pass.normals->num_buffers() : index_list_blocks(num_rows);
+    std::vector<int64_t> block_lo(num_blocks, std::numeric_limits<int64_t>::max());
+    std::vector<int64_t> block_hi(num_blocks, std::numeric_limits<int64_t>::lowest());
+
+    parallel_for(0, num_blocks, 1, [&](int64_t first_block, int64_t end_block) {
+        for (int64_t block = first_block; block != end_block; ++block) {
+            int64_t end_row = num_rows * (block + 1) / num_blocks;
+            for (int64_t row = num_rows * block / num_blocks; row < end_row; row += kIndexRowsPerPass) {
+                int64_t rows = std::min(kIndexRowsPerPass, end_row - row);
+                size_t offset = size_t(row) * row_size;
+                int64_t part_lo = 0;
+                int64_t part_hi = -1;
+                convert_indices(src + offset, dst + offset, size_t(rows) * row_size, pass.remap, pass.num_vertices,
+                                part_lo, part_hi);
+                block_lo[block] = std::min(block_lo[block], part_lo);
+                block_hi[block] = std::max(block_hi[block], part_hi);
+                // Rows with bad indices are skipped here and reported by the caller.
+                if (pass.normals != nullptr && part_lo >= 0 && part_hi < pass.num_vertices) {
+                    pass.normals->add_faces(block, dst + offset, rows, row_size);
+                }
+            }
+        }
+    });
+
+    lo = *std::min_element(block_lo.begin(), block_lo.end());
+    hi = *std::max_element(block_hi.begin(), block_hi.end());
+}
+
+template <class Src>
+size_t first_index_outside(const Src* src, size_t n, int64_t num_vertices) {
+    for (size_t i = 0; i != n; ++i) {
+        if (int64_t(src[i]) < 0 || int64_t(src[i]) >= num_vertices) {
+            return i;
+        }
+    }
+    return n;
+}
+
+template <class Src>
+void extract_indices_from(const Src* src, size_t n, torch::Tensor& dest, IndexListPass pass,
+                          const PLYProperty& property, uint32_t row_size) {
+    const int64_t num_vertices = pass.num_vertices;
+    // Remapped indices and faces feeding normals are always range checked,
+    // nothing can be looked up for them otherwise.
+    bool validate = pass.validate || pass.remap != nullptr || pass.normals != nullptr;
+    if (num_vertices == 0) {
+        pass.remap = nullptr;
+        pass.normals = nullptr;
+    }
+
+    int64_t num_rows = (row_size != 0) ? int64_t(n / row_size) : 0;
+    int64_t lo = 0;
+    int64_t hi = -1;
+    switch (dest.scalar_type()) {
+        case torch::kInt32:
+            convert_index_rows(src, dest.data_ptr<int32_t>(), num_rows, row_size, pass, lo, hi);
+            break;
+        case torch::kInt64:
+            convert_index_rows(src, dest.data_ptr<int64_t>(), num_rows, row_size, pass, lo, hi);
+            break;
+        default:
+            convert_index_rows(src, reinterpret_cast<Src*>(dest.data_ptr()), num_rows, row_size, pass, lo, hi);
+            break;
+    }
+    if (n == 0) {
+        return;
+    }
+
+    if (dest.scalar_type() == torch::kInt32 && hi > std::numeric_limits<int32_t>::max()) {
+        throw std::runtime_error("list property '" + property.name + "' has index " + std::to_string(hi) +
+                                 ", which does not fit into int32");
+    }
+    if (validate && (lo < 0 || hi >= num_vertices)) {
+        size_t i = first_index_outside(src, n, num_vertices);
+        throw std::runtime_error("list property '" + property.name + "': face " + std::to_string(i / row_size) +
+                                 " refers to vertex " + std::to_string(int64_t(src[i])) + ", but there are only " +
+                                 std::to_string(num_vertices) + " vertices");
+    }
+}
+
+// Inputs recorded by the profiler scopes around an element: its name, number
+// of rows and, when its rows have a fixed size, its size in bytes (else -1).
+std::vector<c10::IValue> element_trace_inputs(const miniply::PLYElement& element) {
+    int64_t bytes = element.fixedSize ? int64_t(element.rowStride) * int64_t(element.count) : -1;
+    return {c10::IValue(element.name), c10::IValue(int64_t(element.count)), c10::IValue(bytes)};
+}
+
+// Inputs recorded by the profiler scopes around the extraction of a property:
+// the element and property names, the number of rows and the bytes written.
+std::vector<c10::IValue> extract_trace_inputs(const miniply::PLYElement& element, const std::string& property,
+                                              const torch::Tensor& dest) {
+    return {c10::IValue(element.name), c10::IValue(property), c10::IValue(int64_t(element.count)),
+            c10::IValue(int64_t(dest.nbytes()))};
+}
+
+// Runs `parallel_for` on ATen's intra-op thread pool and sizes it to match.
+// Inside ATen's own parallel regions everything runs on the calling thread,
+// and so it does in DataLoader workers, which PyTorch limits to one thread.
+ParallelBackend aten_parallel_backend() {
+    ParallelBackend backend;
+    backend.num_threads = []() -> int64_t {
+        return at::in_parallel_region() ? 1 : int64_t(at::get_num_threads());
+    };
+    backend.run = [](int64_t num_chunks, const std::function<void(int64_t chunk)>& run_chunk) {
+        at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t chunk = begin; chunk < end; ++chunk) {
+                run_chunk(chunk);
+            }
+        });
+    };
+    return backend;
+}
+
+// Makes the chunks of `parallel_for` run on worker threads with the profiler
+// state of the thread that started it, each in a scope of its own, so that
+// they show up in its traces. Nothing is done while nobody is recording.
+ParallelChunkRunner traced_chunk_runner() {
+    if (!at::hasCallbacks()) {
+        return ParallelChunkRunner();
+    }
+    auto state = std::make_shared<at::ThreadLocalState>();
+    return [state](int64_t chunk_begin, int64_t chunk_end, const std::function<void()>& run) {
+        at::ThreadLocalStateGuard state_guard(*state);
+        RECORD_FUNCTION("plytorch::parallel_chunk", std::vector<c10::IValue>({c10::IValue(chunk_begin),
+                                                                                c10::IValue(chunk_end - chunk_begin)}));
+        run();
+    };
+}
+
+// Extracts a vertex index list property into `dest`, converting it to the
+// dtype of `dest`, validating the index range, remapping and accumulating
+// vertex normals as requested by `pass` in the same pass over the data.
+void extract_index_list(miniply::PLYReader& reader, uint32_t prop_idx, torch::Tensor& dest, uint32_t row_size,
+                        const IndexListPass& pass) {
+    const PLYProperty& property = reader.element()->properties[prop_idx];
+    const uint8_t* data = reader.get_list_data(prop_idx);
+    size_t n = reader.sum_of_list_counts(prop_idx);
+
+    switch (property.type) {
+        case PLYPropertyType::Char:
+            extract_indices_from(reinterpret_cast<const int8_t*>(data), n, dest, pass, property, row_size);
+            break;
+        case PLYPropertyType::UChar:
+            extract_indices_from(reinterpret_cast<const uint8_t*>(data), n, dest, pass, property, row_size);
+            break;
+        case PLYPropertyType::Short:
+            extract_indices_from(reinterpret_cast<const int16_t*>(data), n, dest, pass, property, row_size);
+            break;
+        case PLYPropertyType::UShort:
+            extract_indices_from(reinterpret_cast<const uint16_t*>(data), n, dest, pass, property, row_size);
+            break;
+        case PLYPropertyType::Int:
+            extract_indices_from(reinterpret_cast<const int32_t*>(data), n, dest, pass, property, row_size);
+            break;
+        case PLYPropertyType::UInt:
+            extract_indices_from(reinterpret_cast<const uint32_t*>(data), n, dest, pass, property, row_size);
+            break;
+        default:
+            throw std::runtime_error("list property '" + property.name + "' does not hold integer indices");
+    }
+}
+
+torch::Tensor find_property(const PropertiesType& props, const std::string& name) {
+    for (const auto& [prop_name, data] : props) {
+        if (prop_name == name) {
+            return data;
+        }
+    }
+    return torch::Tensor();
+}
+
+// Welds the vertex element just decoded into `props`:
+// vertices in the same `epsilon` grid cell are merged into the first of them.
+// Returns the new index of every original vertex, or an undefined tensor if the
+// element has no positions.
+torch::Tensor weld_vertex_element(PropertiesType& props, double epsilon) {
+    torch::Tensor x = find_property(props, "x");
+    torch::Tensor y = find_property(props, "y");
+    torch::Tensor z = find_property(props, "z");
+    if (!x.defined() || !y.defined() || !z.defined()) {
+        return torch::Tensor();
+    }
+
+    // Taken from the extracted properties rather than the reader, which may
+    // only hold the last chunk of rows.
+    int64_t n = x.size(0);
+    // Cells are found from the coordinates as loaded, only converted (to
+    // double) if they aren't all float or all double.
+    torch::ScalarType type = x.scalar_type();
+    if ((type != torch::kFloat32 && type != torch::kFloat64) || y.scalar_type() != type || z.scalar_type() != type) {
+        type = torch::kFloat64;
+    }
+    x = x.to(type).contiguous();
+    y = y.to(type).contiguous();
+    z = z.to(type).contiguous();
+
+    torch::Tensor remap = torch::empty({n}, at::TensorOptions().dtype(torch::kInt64).device(torch::kCPU));
+    std::vector<int64_t> kept;
+    if (type == torch::kFloat32) {
+        weld_vertices(x.data_ptr<float>(), y.data_ptr<float>(), z.data_ptr<float>(), n, epsilon,
+                      remap.data_ptr<int64_t>(), kept);
+    } else {
+        weld_vertices(x.data_ptr<double>(), y.data_ptr<double>(), z.data_ptr<double>(), n, epsilon,
+                      remap.data_ptr<int64_t>(), kept);
+    }
+
+    if (int64_t(kept.size()) != n) {
+        torch::Tensor kept_idx = torch::empty({int64_t(kept.size())},
+                                              at::TensorOptions().dtype(torch::kInt64).device(torch::kCPU));
+        std::memcpy(kept_idx.data_ptr(), kept.data(), kept.size() * sizeof(int64_t));
+        for (auto& [prop_name, data] : props) {
+            data = data.index_select(0, kept_idx);
+        }
+    }
+    return remap;
+}
+
+// Collects what faces need from the vertex element that `reader` has just
+// decoded into `props`, welding it first if requested.
+VertexInfo process_vertex_element(miniply::PLYReader& reader, PropertiesType& props, const ReadOptions& options) {
+    VertexInfo info;
+    if (options.weld_epsilon > 0.0) {
+        info.remap = weld_vertex_element(props, options.weld_epsilon);
+    }
+    info.num_vertices = props.empty() ? 0 : props.front().second.size(0);
+
+    uint32_t normal_idxs[3];
+    if (options.compute_normals && !reader.find_normal(normal_idxs)) {
+        torch::Tensor x = find_property(props, "x");
+        torch::Tensor y = find_property(props, "y");
+        torch::Tensor z = find_property(props, "z");
+        if (x.defined() && y.defined() && z.defined()) {
+            info.positions = torch::stack({x, y, z}, 1).to(torch::kFloat32).contiguous();
+        }
+    }
+    return info;
+}
+
+// Computes vertex normals from an already extracted index list, for files
+// where the faces precede the vertices.
+torch::Tensor compute_vertex_normals(const torch::Tensor& positions, const torch::Tensor& faces) {
+    torch::Tensor indices = faces.to(torch::kInt64).contiguous();
+    int64_t num_vertices = positions.size(0);
+    if (indices.numel() != 0 &&
+        (indices.min().item<int64_t>() < 0 || indices.max().item<int64_t>() >= num_vertices)) {
+        throw std::runtime_error("cannot compute vertex normals: faces refer to vertices that don't exist");
+    }
+
+    int64_t num_faces = indices.size(0);
+    int64_t face_size = indices.size(1);
+    const int64_t* face_data = indices.data_ptr<int64_t>();
+    VertexNormalAccumulator normals(positions.data_ptr<float>(), num_vertices, index_list_blocks(num_faces));
+    int64_t num_blocks = normals.num_buffers();
+    parallel_for(0, num_blocks, 1, [&](int64_t first_block, int64_t end_block) {
+        for (int64_t block = first_block; block != end_block; ++block) {
+            int64_t first_face = num_faces * block / num_blocks;
+            int64_t end_face = num_faces * (block + 1) / num_blocks;
+            normals.add_faces(block, face_data + first_face * face_size, end_face - first_face, face_size);
+        }
+    });
+
+    torch::Tensor result = torch::empty({num_vertices, 3}, at::TensorOptions().dtype(torch::kFloat32).device(torch::kCPU));
+    normals.finish(result.data_ptr<float>());
+    return result;
+}
+
+// Builds vertex -> face adjacency from an extracted, valid index list with
+// `counts[f]` entries in row `f`. Returns (offsets, face_ids).
+std::pair<torch::Tensor, torch::Tensor> vertex_face_adjacency(const torch::Tensor& faces, const uint32_t* counts,
+                                                              int64_t num_vertices) {
+    auto options = at::TensorOptions().dtype(torch::kInt64).device(torch::kCPU);
+    torch::Tensor offsets = torch::empty({num_vertices + 1}, options);
+    torch::Tensor face_ids = torch::empty({faces.numel()}, options);
+    int64_t num_faces = faces.size(0);
+
+    switch (faces.scalar_type()) {
+    case torch::kUInt8:
+        build_vertex_face_adjacency(faces.data_ptr<uint8_t>(), counts, num_faces, nullptr, num_vertices,
+                                    offsets.data_ptr<int64_t>(), face_ids.data_ptr<int64_t>());
+        break;
+    case torch::kInt16:
+        build_vertex_face_adjacency(faces.data_ptr<int16_t>(), counts, num_faces, nullptr, num_vertices,
+                                    offsets.data_ptr<int64_t>(), face_ids.data_ptr<int64_t>());
+        break;
+    case torch::kUInt16:
+        build_vertex_face_adjacency(static_cast<const uint16_t*>(faces.data_ptr()), counts, num_faces, nullptr,
+                                    num_vertices, offsets.data_ptr<int64_t>(), face_ids.data_ptr<int64_t>());
+        break;
+    case torch::kInt32:
+        build_vertex_face_adjacency(faces.data_ptr<int32_t>(), counts, num_faces, nullptr, num_vertices,
+                                    offsets.data_ptr<int64_t>(), face_ids.data_ptr<int64_t>());
+        break;
+    case torch::kUInt32:
+        build_vertex_face_adjacency(static_cast<const uint32_t*>(faces.data_ptr()), counts, num_faces, nullptr,
+                                    num_vertices, offsets.data_ptr<int64_t>(), face_ids.data_ptr<int64_t>());
+        break;
+    case torch::kInt64:
+        build_vertex_face_adjacency(faces.data_ptr<int64_t>(), counts, num_faces, nullptr, num_vertices,
+                                    offsets.data_ptr<int64_t>(), face_ids.data_ptr<int64_t>());
+        break;
+    default:
+        throw std::runtime_error("unsupported vertex index dtype '" + std::string(toString(faces.scalar_type())) + "'");
+    }
+    return {offsets, face_ids};
+}
+
+// Applies the vertex remap to index lists that were extracted before the
+// vertex element was welded, which only happens when faces precede vertices.
+void remap_index_lists(PropertiesType& props, const torch::Tensor& remap) {
+    for (auto& [prop_name, data] : props) {
+        if ((prop_name != "vertex_index" && prop_name != "vertex_indices") || data.numel() == 0) {
+            continue;
+        }
+        torch::Tensor indices = data.reshape({-1}).to(torch::kInt64);
+        int64_t lo = indices.min().item<int64_t>();
+        int64_t hi = indices.max().item<int64_t>();
+        if (lo < 0 || hi >= remap.size(0)) {
+            throw std::runtime_error("list property '" + prop_name + "' refers to vertex " +
+                                     std::to_string(lo < 0 ? lo : hi) + ", but there are only " +
+                                     std::to_string(remap.size(0)) + " vertices");
+        }
+        data.copy_(remap.index_select(0, indices).reshape(data.sizes()));
+    }
+}
+
+// Rows of the current element of `reader` to load at a time to keep it within
+// `options.max_memory`, or 0 to load the element whole.
+uint32_t element_chunk_rows(const miniply::PLYReader& reader, const ReadOptions& options) {
+    const miniply::PLYElement* element = reader.element();
+    int64_t bytes = int64_t(element->rowStride) * element->count;
+    if (options.max_memory <= 0 || !element->fixedSize || reader.loads_in_place() || bytes <= options.max_memory) {
+        return 0;
+    }
+    return uint32_t(std::max<int64_t>(1, options.max_memory / element->rowStride));
+}
+
+// Loads the current element of `reader`, unless it is to be loaded in chunks
+// of rows by `read_element_in_chunks`.
+bool load_element(miniply::PLYReader& reader, const ReadOptions& options) {
+    if (element_chunk_rows(reader, options) != 0) {
+        return true;
+    }
+    RECORD_FUNCTION("plytorch::load_element", element_trace_inputs(*reader.element()));
+    return reader.load_element();
+}
+
+// Reads the current element of `reader`, which is fixed-size, loading
+// `chunk_rows` rows at a time and extracting them into the output tensors.
+std::pair<std::string, PropertiesType> read_element_in_chunks(miniply::PLYReader& reader, uint32_t chunk_rows,
+                                                              ReadState& state) {
+    const miniply::PLYElement* element = reader.element();
+    PropertiesType props_dict;
+    PLYStats element_stats;
+    PLYStats* stats = state.profiler->enabled() ? &element_stats : nullptr;
+    for (const auto& property : element->properties) {
+        props_dict.emplace_back(property.name,
+                                allocate_tensor({int64_t(element->count)}, get_torch_dtype(property.type), stats));
+    }
+
+    while (true) {
+        {
+            RECORD_FUNCTION("plytorch::load_element", std::vector<c10::IValue>({c10::IValue(element->name),
+                            c10::IValue(int64_t(chunk_rows)), c10::IValue(int64_t(chunk_rows) * element->rowStride)}));
+            if (!reader.load_element_rows(chunk_rows)) {
+                break;
+            }
+        }
+        int64_t first_row = reader.first_loaded_row();
+        for (uint32_t i = 0; i != uint32_t(props_dict.size()); ++i) {
+            torch::Tensor& data = props_dict[i].second;
+            reader.extract_properties(&i, 1, element->properties[i].type,
+                                      static_cast<char*>(data.data_ptr()) + first_row * data.element_size());
+        }
+    }
+    if (!reader.valid() || reader.first_loaded_row() + reader.loaded_rows() != element->count) {
+        throw std::runtime_error("Failed to read element '" + element->name + "'");
+    }
+
+    state.profiler->add(element_stats);
+    return {element->name, props_dict};
+}
+
+std::pair<std::string, PropertiesType> read_element_properties(miniply::PLYReader& reader, int element_idx,
+                                                               const ReadOptions& options, ReadState& state) {
+    uint32_t chunk_rows = element_chunk_rows(reader, options);
+    if (chunk_rows != 0) {
+        return read_element_in_chunks(reader, chunk_rows, state);
+    }
+
     auto element = reader.get_element(element_idx);
     PropertiesType props_dict;
+    PLYStats element_stats;
+    PLYStats* stats = state.profiler->enabled() ? &element_stats : nullptr;
     uint32_t N = element->count;
     std::vector<std::string> prop_names;
 
+    bool extract_as_indices = !options.index_dtype.empty() || options.validate_indices || options.vertex_face_adjacency;
+    uint32_t vertex_idx = reader.find_element(miniply::kPLYVertexElement);
+    int64_t num_vertices = (vertex_idx != miniply::kInvalidIndex) ? reader.get_element(vertex_idx)->count : 0;
+    bool wait_for_vertices = options.needs_vertex_info() && vertex_idx != miniply::kInvalidIndex &&
+                             vertex_idx < uint32_t(element_idx);
+
     uint32_t i = 0;
     for (const auto & property : element->properties) {
         std::string prop_name = property.name;
@@ -100,37 +716,515 @@ std::pair<std::string, PropertiesType> read_ply_element(miniply::PLYReader& read
                 throw std::runtime_error("list property '" + property.name + "' has varying rowcount(from "+std::to_string(rowcounts[0])+" to "+std::to_string(rowcounts[rowcounts.size() - 1])+"), which is not supported!");
             }
 
-            torch::Tensor data = torch::empty({N, rowcounts[0]},
-                                              at::TensorOptions().dtype(prop_dtype).device(torch::kCPU));
+            // Faces wait here for the vertex element, possibly decoded on another thread.
+            VertexInfo vertex_info;
+            if (wait_for_vertices && is_index_property(property)) {
+                vertex_info = state.vertex_info_ready.get();
+            }
+
+            bool is_index = (extract_as_indices || vertex_info.remap.defined() || vertex_info.positions.defined()) &&
+                            is_index_property(property);
+            if (is_index && !options.index_dtype.empty()) {
+                prop_dtype = get_index_dtype(options.index_dtype);
+            }
+
+            torch::Tensor data = allocate_tensor({int64_t(N), int64_t(rowcounts[0])}, prop_dtype, stats);
 
             props_dict.emplace_back(prop_name, data);
-            reader.extract_list_property(i, property.type, data.data_ptr());
+            if (is_index) {
+                IndexListPass pass;
+                pass.num_vertices = num_vertices;
+                pass.validate = options.validate_indices || options.vertex_face_adjacency;
+                pass.remap = vertex_info.remap.defined() ? vertex_info.remap.data_ptr<int64_t>() : nullptr;
+
+                std::unique_ptr<VertexNormalAccumulator> normals;
+                if (vertex_info.positions.defined()) {
+                    normals = std::make_unique<VertexNormalAccumulator>(
+                        vertex_info.positions.data_ptr<float>(), vertex_info.positions.size(0), index_list_blocks(N));
+                    pass.normals = normals.get();
+                }
+
+                {
+                    RECORD_FUNCTION("plytorch::extract_index_list", extract_trace_inputs(*element, prop_name, data));
+                    PLYStatsTimer timer(stats, &PLYStats::index_ns);
+                    extract_index_list(reader, i, data, rowcounts[0], pass);
+                }
+
+                PLYStatsTimer postprocess_timer(stats, &PLYStats::postprocess_ns);
+                if (normals) {
+                    torch::Tensor vertex_normals = torch::empty({vertex_info.positions.size(0), 3},
+                                                                at::TensorOptions().dtype(torch::kFloat32).device(torch::kCPU));
+                    normals->finish(vertex_normals.data_ptr<float>());
+                    std::lock_guard<std::mutex> lock(state.faces_mutex);
+                    state.vertex_normals = vertex_normals;
+                }
+
+                // Faces preceding welded vertices get their adjacency once the remap is known.
+                bool welded_later = options.weld_epsilon > 0.0 && vertex_idx != miniply::kInvalidIndex &&
+                                    vertex_idx > uint32_t(element_idx);
+                if (options.vertex_face_adjacency && !welded_later) {
+                    auto adjacency = vertex_face_adjacency(data, property.rowCount.data(),
+                                                           wait_for_vertices ? vertex_info.num_vertices : num_vertices);
+                    std::lock_guard<std::mutex> lock(state.faces_mutex);
+                    if (!state.vertex_face_offsets.defined()) {
+                        state.vertex_face_offsets = adjacency.first;
+                        state.vertex_face_ids = adjacency.second;
+                    }
+                }
+            } else {
+                RECORD_FUNCTION("plytorch::extract_list_property", extract_trace_inputs(*element, prop_name, data));
+                reader.extract_list_property(i, property.type, data.data_ptr());
+            }
         } else {
             torch::ScalarType prop_dtype = get_torch_dtype(property.type);
-            torch::Tensor data = torch::empty({N,},
-                                              at::TensorOptions().dtype(prop_dtype).device(torch::kCPU));
+            torch::Tensor data = allocate_tensor({int64_t(N)}, prop_dtype, stats);
             props_dict.emplace_back(prop_name, data);
+            RECORD_FUNCTION("plytorch::extract_properties", extract_trace_inputs(*element, prop_name, data));
             reader.extract_properties(&i, 1, property.type, data.data_ptr());
         }
         ++i;
     }
 
+    state.profiler->add(element_stats);
     return {element->name, props_dict};
 }
 
-ElementsType read_ply(const std::string& path) {
-    miniply::PLYReader reader(path.c_str());
+std::pair<std::string, PropertiesType> read_ply_element(miniply::PLYReader& reader, int element_idx,
+                                                        const ReadOptions& options, ReadState& state) {
+    RECORD_FUNCTION("plytorch::read_ply_element", element_trace_inputs(*reader.get_element(element_idx)));
+    if (!options.needs_vertex_info() || uint32_t(element_idx) != reader.find_element(miniply::kPLYVertexElement)) {
+        return read_element_properties(reader, element_idx, options, state);
+    }
 
-    if (!reader.valid()) {
+    // Whatever happens, elements waiting for the vertex element must be released.
+    try {
+        auto result = read_element_properties(reader, element_idx, options, state);
+        PLYStats vertex_stats;
+        VertexInfo vertex_info;
+        {
+            PLYStatsTimer timer(state.profiler->enabled() ? &vertex_stats : nullptr, &PLYStats::postprocess_ns);
+            vertex_info = process_vertex_element(reader, result.second, options);
+        }
+        state.profiler->add(vertex_stats);
+        state.vertex_info.set_value(std::move(vertex_info));
+        return result;
+    } catch (...) {
+        state.vertex_info.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+// Elements smaller than this are not worth a thread and a reader of their own.
+constexpr int64_t kParallelElementMinBytes = 1 << 20;
+
+// Opens another reader on the data being read, so that elements can be decoded
+// independently. The reader adds its stats to `stats` unless that is null.
+using ReaderFactory = std::function<std::unique_ptr<miniply::PLYReader>(miniply::PLYReaderStats* stats)>;
+
+std::pair<std::string, PropertiesType> read_ply_element_at(const ReaderFactory& open_reader, const std::string& name,
+                                                           uint32_t element_idx, int64_t offset,
+                                                           const ReadOptions& options, ReadState& state) {
+    std::unique_ptr<miniply::PLYReader> reader = open_reader(state.profiler->reader_stats());
+
+    if (!reader->valid() || !reader->seek_element(element_idx, offset) || !load_element(*reader, options)) {
+        throw std::runtime_error("Failed to read element " + std::to_string(element_idx) + " from: " + name);
+    }
+    return read_ply_element(*reader, element_idx, options, state);
+}
+
+// Reads all elements through `reader`, which must be valid. Without
+// `open_reader` (e.g. for streams) elements are decoded one after another.
+// `name` identifies the data in error messages. `reader` and any others
+// opened get their stats from `profiler`.
+ReadResult read_ply_from(miniply::PLYReader& reader, const ReaderFactory& open_reader, const std::string& name,
+                         const ReadOptions& options, ReadProfiler& profiler) {
+    uint32_t num_elements = reader.num_elements();
+    ElementsType result(num_elements);
+    ReadState state;
+    state.profiler = &profiler;
+    ReadResult read_result;
+
+    // In binary files every element preceded only by fixed-size elements has an
+    // offset known right after the header. Such elements are decoded on
+    // separate threads, each through its own reader, as long as the reader of
+    // the following element doesn't have to parse through them to get past.
+    // Under a memory budget, only elements used in place are, as they don't
+    // take up memory in their readers. Nothing is when limited to one thread.
+    bool parallel = open_reader && worker_threads_here() > 1 &&
+                    (options.max_memory <= 0 || reader.loads_in_place());
+    std::vector<uint32_t> parallel_elements;
+    for (uint32_t i = 0; parallel && i != num_elements; ++i) {
+        int64_t offset = reader.element_offset(i);
+        int64_t next_offset = (i + 1 != num_elements) ? reader.element_offset(i + 1) : -1;
+        if (offset < 0 || (i + 1 != num_elements && next_offset < 0)) {
+            continue;
+        }
+        if (i + 1 != num_elements && next_offset - offset < kParallelElementMinBytes) {
+            continue;
+        }
+        parallel_elements.push_back(i);
+    }
+    // Elements decoded at once share the threads of this one, so that their
+    // own `parallel_for` calls don't oversubscribe the CPU together: there are
+    // no more of them than threads, and each is limited to its part of them.
+    // The others are decoded in turn.
+    const int64_t num_threads = worker_threads_here();
+    if (int64_t(parallel_elements.size()) > num_threads) {
+        parallel_elements.resize(size_t(num_threads));
+    }
+    if (parallel_elements.size() < 2) {
+        parallel_elements.clear();
+    }
+    auto thread_share = [&](size_t k) {
+        const int64_t n = int64_t(parallel_elements.size());
+        return num_threads / n + (int64_t(k) < num_threads % n ? 1 : 0);
+    };
+
+    // The last parallel element is decoded on this thread, in turn with the
+    // serial ones. Elements are only ever waited for by elements that follow
+    // them, so walking them in order can't deadlock. Workers take on the
+    // profiler state of this thread, so that their elements show up in traces.
+    at::ThreadLocalState thread_state;
+    std::vector<std::future<std::pair<std::string, PropertiesType>>> pending;
+    std::optional<ScopedWorkerThreadLimit> own_limit;
+    try {
+        for (size_t k = 0; k + 1 < parallel_elements.size(); ++k) {
+            uint32_t idx = parallel_elements[k];
+            int64_t offset = reader.element_offset(idx);
+            int64_t thread_limit = thread_share(k);
+            pending.push_back(std::async(std::launch::async, [&, idx, offset, thread_limit]() {
+                at::ThreadLocalStateGuard state_guard(thread_state);
+                ScopedWorkerThreadLimit limit(thread_limit);
+                return read_ply_element_at(open_reader, name, idx, offset, options, state);
+            }));
+        }
+        if (!parallel_elements.empty()) {
+            own_limit.emplace(thread_share(parallel_elements.size() - 1));
+        }
+
+        size_t next_parallel = 0;
+        for (uint32_t i = 0; i != num_elements; ++i) {
+            if (next_parallel < parallel_elements.size() && parallel_elements[next_parallel] == i) {
+                if (++next_parallel == parallel_elements.size()) {
+                    result[i] = read_ply_element_at(open_reader, name, i, reader.element_offset(i), options, state);
+                }
+                continue;
+            }
+            int64_t offset = reader.element_offset(i);
+            if (offset >= 0 && !reader.seek_element(i, offset)) {
+                throw std::runtime_error("Failed to read element " + std::to_string(i) + " from: " + name);
+            }
+            load_element(reader, options);
+            result[i] = read_ply_element(reader, i, options, state);
+            reader.next_element();
+        }
+    } catch (...) {
+        // Don't leave workers blocked on a vertex element that will never be welded.
+        try {
+            state.vertex_info.set_exception(std::current_exception());
+        } catch (const std::future_error&) {
+        }
+        throw;
+    }
+    own_limit.reset();
+
+    for (size_t k = 0; k != pending.size(); ++k) {
+        result[parallel_elements[k]] = pending[k].get();
+    }
+
+    PLYStats postprocess_stats;
+    uint32_t vertex_idx = reader.find_element(miniply::kPLYVertexElement);
+    if (options.needs_vertex_info() && vertex_idx != miniply::kInvalidIndex) {
+        PLYStatsTimer timer(profiler.enabled() ? &postprocess_stats : nullptr, &PLYStats::postprocess_ns);
+        VertexInfo vertex_info = state.vertex_info_ready.get();
+        for (uint32_t i = 0; i < vertex_idx; ++i) {
+            if (vertex_info.remap.defined()) {
+                remap_index_lists(result[i].second, vertex_info.remap);
+            }
+            for (const char* name : {"vertex_index", "vertex_indices"}) {
+                torch::Tensor faces = find_property(result[i].second, name);
+                if (vertex_info.positions.defined() && faces.defined() && !state.vertex_normals.defined()) {
+                    state.vertex_normals = compute_vertex_normals(vertex_info.positions, faces);
+                }
+                if (options.vertex_face_adjacency && options.weld_epsilon > 0.0 && faces.defined() &&
+                    !state.vertex_face_offsets.defined()) {
+                    std::vector<uint32_t> counts(faces.size(0), uint32_t(faces.size(1)));
+                    std::tie(state.vertex_face_offsets, state.vertex_face_ids) =
+                        vertex_face_adjacency(faces, counts.data(), vertex_info.num_vertices);
+                }
+            }
+        }
+
+        if (state.vertex_normals.defined()) {
+            PropertiesType& vertex_props = result[vertex_idx].second;
+            vertex_props.emplace_back("nx", state.vertex_normals.select(1, 0));
+            vertex_props.emplace_back("ny", state.vertex_normals.select(1, 1));
+            vertex_props.emplace_back("nz", state.vertex_normals.select(1, 2));
+        }
+    }
+    profiler.add(postprocess_stats);
+
+    read_result.elements = std::move(result);
+    if (state.vertex_face_offsets.defined()) {
+        read_result.extras.emplace_back("vertex_face_offsets", state.vertex_face_offsets);
+        read_result.extras.emplace_back("vertex_face_ids", state.vertex_face_ids);
+    }
+    read_result.stats = profiler.finish();
+    return read_result;
+}
+
+ReadResult read_ply(const std::string& path, const ReadOptions& options) {
+    RECORD_FUNCTION("plytorch::read_ply", std::vector<c10::IValue>({c10::IValue(path)}));
+    ReadStrategy requested = parse_read_strategy(options.strategy);
+    ReadProfiler profiler(options);
+    // Compressed data is inflated from the moment it is opened, so a thread
+    // count that was asked for applies before the plan is made too.
+    std::optional<ScopedWorkerThreadLimit> requested_limit;
+    if (options.threads > 0) {
+        requested_limit.emplace(options.threads);
+    }
+    auto reader = std::make_unique<miniply::PLYReader>(open_decompressed(miniply::open_file_source(path.c_str())),
+                                                       profiler.reader_stats());
+    if (!reader->valid()) {
         throw std::runtime_error("Failed to open specified path: " + path);
     }
+    ReadPlan plan = plan_read(path, *reader, requested, options.threads);
+    ScopedWorkerThreadLimit limit(plan.threads);
+
+    // The header is parsed again from the mapping, which costs next to nothing
+    // next to the files worth mapping.
+    std::shared_ptr<MappedFile> mapped;
+    if (plan.strategy == ReadStrategy::Mapped) {
+        mapped = MappedFile::open(path);
+        if (mapped != nullptr) {
+            reader = std::make_unique<miniply::PLYReader>(open_decompressed(mapped->source()), profiler.reader_stats());
+            if (!reader->valid()) {
+                throw std::runtime_error("Failed to open specified path: " + path);
+            }
+        } else {
+            plan.strategy = ReadStrategy::Parallel;
+            plan.reason += "; the file could not be mapped";
+        }
+    }
+
+    // Streaming never seeks, even in files that could: they are read again
+    // through a source that only goes forward, over which elements are skipped.
+    if (plan.strategy == ReadStrategy::Stream && reader->seekable()) {
+        std::shared_ptr<miniply::PLYSource> file = open_decompressed(miniply::open_file_source(path.c_str()));
+        if (file == nullptr) {
+            throw std::runtime_error("Failed to open specified path: " + path);
+        }
+        reader = std::make_unique<miniply::PLYReader>(
+            std::make_unique<miniply::PLYCallbackSource>([file](void* dest, size_t size) {
+                return file->read(dest, size);
+            }),
+            profiler.reader_stats());
+        if (!reader->valid()) {
+            throw std::runtime_error("Failed to open specified path: " + path);
+        }
+    }
 
-    ElementsType result;
+    // Compressed files, pipes, FIFOs and stdin can't be opened a second time to
+    // read elements in parallel.
+    ReaderFactory open_reader;
+    if (reader->seekable() && path != "-" && plan.threads > 1) {
+        if (mapped != nullptr) {
+            open_reader = [mapped](miniply::PLYReaderStats* stats) {
+                return std::make_unique<miniply::PLYReader>(mapped->source(), stats);
+            };
+        } else if (plan.strategy == ReadStrategy::Parallel) {
+            open_reader = [&path](miniply::PLYReaderStats* stats) {
+                return std::make_unique<miniply::PLYReader>(miniply::open_file_source(path.c_str()), stats);
+            };
+        }
+    }
 
-    for (int i = 0; i != reader.num_elements(); ++i) {
-        reader.load_element();
-        result.push_back(read_ply_element(reader, i));
-        reader.next_element();
+    PLYStats strategy_stats;
+    switch (plan.strategy) {
+        case ReadStrategy::Parallel:
+            strategy_stats.parallel_reads = 1;
+            break;
+        case ReadStrategy::Mapped:
+            strategy_stats.mapped_reads = 1;
+            break;
+        case ReadStrategy::Stream:
+            strategy_stats.stream_reads = 1;
+            break;
+        default:
+            strategy_stats.buffered_reads = 1;
+            break;
+    }
+    profiler.add(strategy_stats);
+
+    ReadResult result = read_ply_from(*reader, open_reader, path, options, profiler);
+    result.plan = std::move(plan);
+    return result;
+}
+
+// Size in bytes of a Python buffer, which must be C-contiguous.
+size_t contiguous_buffer_size(const py::buffer_info& info) {
+    int64_t expected_stride = info.itemsize;
+    for (int64_t dim = info.ndim - 1; dim >= 0; --dim) {
+        if (info.shape[dim] > 1 && info.strides[dim] != expected_stride) {
+            throw std::runtime_error("PLY data buffer must be contiguous");
+        }
+        expected_stride *= info.shape[dim];
+    }
+    return size_t(info.size * info.itemsize);
+}
+
+// Reads PLY data held in memory. Binary elements are extracted straight from
+// it, without staging them in the reader.
+ReadResult read_ply_memory(const void* ptr, size_t size, const std::string& name, const ReadOptions& options) {
+    RECORD_FUNCTION("plytorch::read_ply", std::vector<c10::IValue>({c10::IValue(name), c10::IValue(int64_t(size))}));
+    ReadProfiler profiler(options);
+    if (is_compressed(static_cast<const uint8_t*>(ptr), size)) {
+        miniply::PLYReader reader(open_decompressed(std::make_unique<miniply::PLYMemorySource>(ptr, size)),
+                                  profiler.reader_stats());
+        if (!reader.valid()) {
+            throw std::runtime_error("Failed to parse compressed PLY data from: " + name);
+        }
+        return read_ply_from(reader, ReaderFactory(), name, options, profiler);
+    }
+
+    ReaderFactory open_reader = [ptr, size](miniply::PLYReaderStats* stats) {
+        return std::make_unique<miniply::PLYReader>(std::make_unique<miniply::PLYMemorySource>(ptr, size), stats);
+    };
+    std::unique_ptr<miniply::PLYReader> reader = open_reader(profiler.reader_stats());
+    if (!reader->valid()) {
+        throw std::runtime_error("Failed to parse PLY data from: " + name);
+    }
+    return read_ply_from(*reader, open_reader, name, options, profiler);
+}
+
+// Reads PLY data held in any contiguous Python buffer (bytes, bytearray,
+// memoryview, numpy array...).
+ReadResult read_ply_buffer(const py::buffer& data, const ReadOptions& options) {
+    py::buffer_info info = data.request();
+    return read_ply_memory(info.ptr, contiguous_buffer_size(info), "<buffer>", options);
+}
+
+// Walks through the members of a tar archive (possibly gzip compressed) in a
+// single sequential pass. `next` moves to the following selected member,
+// whose data has already been read in the background; `read` decodes it
+// straight from that data. Both run without the GIL.
+class TarPLYIterator {
+public:
+    TarPLYIterator(const std::string& path, std::vector<std::string> patterns) :
+        m_path(path), m_reader(open_tar(path), std::move(patterns)) {}
+
+    std::optional<std::string> next() {
+        py::gil_scoped_release release;
+        m_member = m_reader.next();
+        if (!m_member) {
+            return std::nullopt;
+        }
+        return m_member->name;
+    }
+
+    ReadResult read(const ReadOptions& options) {
+        if (!m_member) {
+            throw std::runtime_error("no current tar member, call next() first");
+        }
+        py::gil_scoped_release release;
+        return read_ply_memory(m_member->data.data(), m_member->data.size(), m_path + ":" + m_member->name, options);
+    }
+
+private:
+    static std::unique_ptr<miniply::PLYSource> open_tar(const std::string& path) {
+        // A tar archive starts with the name of its first member, which may
+        // look like a zlib header, so only gzip is detected.
+        std::unique_ptr<miniply::PLYSource> source =
+            open_decompressed(miniply::open_file_source(path.c_str()), false);
+        if (source == nullptr) {
+            throw std::runtime_error("Failed to open specified path: " + path);
+        }
+        return source;
+    }
+
+    std::string m_path;
+    TarReader m_reader;
+    std::optional<TarMember> m_member;
+};
+
+// Returns the rows of the last element of a PLY file as they are written to
+// it, see PLYFollower.
+class PLYFollowIterator {
+public:
+    explicit PLYFollowIterator(const std::string& path) : m_follower(path) {}
+
+    // Waits up to `timeout` seconds for the file to change.
+    bool wait(double timeout) {
+        py::gil_scoped_release release;
+        return m_follower.wait(int64_t(timeout * 1000.0));
+    }
+
+    // Up to `max_rows` (all if negative) new whole rows, a tensor per
+    // property, or nothing if there are none yet.
+    std::optional<PropertiesType> read(int64_t max_rows) {
+        py::gil_scoped_release release;
+        int64_t num_rows = m_follower.read(max_rows, m_rows);
+        if (num_rows == 0) {
+            return std::nullopt;
+        }
+        RECORD_FUNCTION("plytorch::follow_read", std::vector<c10::IValue>({c10::IValue(num_rows)}));
+        PropertiesType properties;
+        const miniply::PLYElement& element = m_follower.element();
+        for (uint32_t i = 0; i != uint32_t(element.properties.size()); ++i) {
+            torch::Tensor values = torch::empty({num_rows}, get_torch_dtype(element.properties[i].type));
+            m_follower.extract(m_rows, num_rows, i, values.data_ptr());
+            properties.emplace_back(element.properties[i].name, values);
+        }
+        return properties;
+    }
+
+    // Name of the element followed, empty until the header has been read.
+    std::string element() const {
+        return m_follower.has_header() ? m_follower.element().name : std::string();
+    }
+
+    int64_t header_count() const { return m_follower.header_count(); }
+    int64_t rows_read() const { return m_follower.rows_read(); }
+
+private:
+    PLYFollower m_follower;
+    std::vector<char> m_rows;
+};
+
+// Reads PLY data from front to back through `readinto`, a Python callable
+// filling a writable memoryview and returning the number of bytes written,
+// like the `readinto` method of binary file objects.
+ReadResult read_ply_stream(const py::function& readinto, const ReadOptions& options) {
+    // Errors raised by `readinto` end the data for miniply, and are rethrown once it has let go.
+    std::exception_ptr read_error;
+    auto read = [&readinto, &read_error](void* dest, size_t size) -> size_t {
+        try {
+            py::object n = readinto(py::memoryview::from_memory(dest, int64_t(size)));
+            return n.is_none() ? 0 : n.cast<size_t>();
+        } catch (...) {
+            read_error = std::current_exception();
+            return 0;
+        }
+    };
+
+    RECORD_FUNCTION("plytorch::read_ply", std::vector<c10::IValue>({c10::IValue("<stream>")}));
+    ReadProfiler profiler(options);
+    miniply::PLYReader reader(open_decompressed(std::make_unique<miniply::PLYCallbackSource>(read)),
+                              profiler.reader_stats());
+    ReadResult result;
+    try {
+        if (!reader.valid()) {
+            throw std::runtime_error("Failed to parse PLY data from stream");
+        }
+        result = read_ply_from(reader, ReaderFactory(), "<stream>", options, profiler);
+    } catch (...) {
+        if (read_error) {
+            std::rethrow_exception(read_error);
+        }
+        throw;
+    }
+    if (read_error) {
+        std::rethrow_exception(read_error);
     }
     return result;
 }
@@ -140,78 +1234,373 @@ void pyprint(const std::string& msg) {
     py::exec("print('"+msg+"')");
 }
 
-bool is_big_endian(void)
-{
-    union {
-        uint32_t i;
-        char c[4];
-    } bint = {0x01020304};
+// Number of rows of a property to write.
+int64_t write_rows(const WritePropertyData& data) {
+    if (const RaggedList* list = std::get_if<RaggedList>(&data)) {
+        return list->second.numel() - 1;
+    }
+    return std::get<torch::Tensor>(data).size(0);
+}
 
-    return bint.c[0] == 1;
+// Checks the offsets of a ragged list property against its values and
+// returns the length of its longest list.
+int64_t check_ragged_list(const std::string& name, const torch::Tensor& values, const torch::Tensor& offsets) {
+    if (!values.device().is_cpu() || !offsets.device().is_cpu()) {
+        throw std::runtime_error("list property '" + name + "' must be made of CPU tensors");
+    }
+    if (values.ndimension() != 1) {
+        throw std::runtime_error("values of list property '" + name + "' must have one dimension, got " +
+                                 std::to_string(values.ndimension()));
+    }
+    if (offsets.ndimension() != 1 || offsets.numel() < 1 || offsets.scalar_type() != torch::kInt64 ||
+        !offsets.is_contiguous()) {
+        throw std::runtime_error("offsets of list property '" + name +
+                                 "' must be a contiguous int64 tensor of one more element than there are rows");
+    }
+    const int64_t* offset = offsets.data_ptr<int64_t>();
+    int64_t num_rows = offsets.numel() - 1;
+    int64_t max_length = 0;
+    for (int64_t row = 0; row != num_rows; ++row) {
+        int64_t length = offset[row + 1] - offset[row];
+        if (length < 0) {
+            throw std::runtime_error("offsets of list property '" + name + "' decrease at row " + std::to_string(row));
+        }
+        max_length = std::max(max_length, length);
+    }
+    if (offset[0] < 0 || offset[num_rows] > values.size(0)) {
+        throw std::runtime_error("offsets of list property '" + name + "' point outside of its " +
+                                 std::to_string(values.size(0)) + " values");
+    }
+    return max_length;
 }
 
+// Describes `elements` for the writer. The tensors must be on the CPU and stay
+// alive while the result is in use. They may have any strides: the writer
+// gathers values from where they are, so views such as the columns of an
+// [N, C] tensor are written without being copied first. List lengths are
+// written as `list_count_type` ("uchar", "ushort" or "uint") or, if "auto",
+// as the smallest of these that holds the longest list.
+std::vector<PLYWriteElement> make_write_elements(const WriteElementsType& elements,
+                                                 const std::string& list_count_type = "auto") {
+    uint32_t count_size = list_count_type == "auto" ? 0 : parse_count_type(list_count_type);
+    std::vector<PLYWriteElement> result;
+    for (const auto& [element_name, element] : elements) {
+        PLYWriteElement write_element;
+        write_element.name = element_name;
+        write_element.count = element.empty() ? 0 : write_rows(element.begin()->second);
 
-bool write_ply(const std::string& path, const ElementsType& elements) {
-    std::ofstream mesh_file(path, std::ios::binary | std::ios::out);
+        for (const auto& [property_name, property_data] : element) {
+            int64_t num_rows = write_rows(property_data);
+            if (num_rows != write_element.count) {
+                throw std::runtime_error("property '" + property_name + "' of element '" + element_name + "' has " +
+                                         std::to_string(num_rows) + " rows, expected " +
+                                         std::to_string(write_element.count));
+            }
 
-    mesh_file << "ply\n";
-    if (is_big_endian()) {
-        mesh_file << "format binary_big_endian 1.0\n";
-    } else {
-        mesh_file << "format binary_little_endian 1.0\n";
-    }
+            const RaggedList* ragged = std::get_if<RaggedList>(&property_data);
+            const torch::Tensor& data = ragged ? ragged->first : std::get<torch::Tensor>(property_data);
+            if (!data.device().is_cpu()) {
+                throw std::runtime_error("property '" + property_name + "' must be a CPU tensor");
+            }
+            if (data.ndimension() < 1 || data.ndimension() > 2) {
+                throw std::runtime_error("property '" + property_name + "' of element '" + element_name +
+                                         "' must have one or two dimensions, got " +
+                                         std::to_string(data.ndimension()));
+            }
 
-    for (const auto &[element_name, element]: elements) {
-        mesh_file << "element " << element_name << " " << element.begin()->second.size(0) << "\n";
-        for (const auto& [property_name, data]: element) {
-            if ((data.ndimension() > 1) && (data.size(1) > 1)) {
-                mesh_file << "property list uchar ";
+            PLYWriteProperty property;
+            property.name = property_name;
+            property.type = get_ply_dtype(data.scalar_type());
+            property.value_size = get_torch_dtype_size(data.scalar_type());
+            property.data = static_cast<const char*>(data.data_ptr());
+            int64_t max_length = 0;
+            if (ragged) {
+                max_length = check_ragged_list(property_name, data, ragged->second);
+                property.is_list = true;
+                property.offsets = ragged->second.data_ptr<int64_t>();
+                property.value_stride = data.stride(0) * property.value_size;
             } else {
-                mesh_file << "property ";
+                property.stride = data.stride(0) * property.value_size;
+                if (data.ndimension() > 1) {
+                    property.value_stride = data.stride(1) * property.value_size;
+                }
+                property.is_list = (data.ndimension() > 1) && (data.size(1) > 1);
+                if (property.is_list) {
+                    max_length = data.size(1);
+                    property.list_size = uint32_t(data.size(1));
+                }
             }
-            mesh_file << get_ply_dtype(data.scalar_type()) << " " << property_name << "\n";
+            if (property.is_list) {
+                property.count_size = count_size != 0 ? count_size : count_size_for(max_length);
+                if (count_size_for(max_length) > property.count_size) {
+                    throw std::runtime_error("list property '" + property_name + "' has rows of " +
+                                             std::to_string(max_length) + " values, more than a " +
+                                             list_count_type + " count can hold");
+                }
+            }
+            write_element.properties.push_back(property);
         }
+        result.push_back(std::move(write_element));
     }
-    mesh_file << "end_header\n";
+    return result;
+}
+
+struct WriteOptions {
+    // Write blocked gzip (BGZF), which plytorch decompresses in parallel when reading.
+    bool compress = false;
+    // zlib compression level, from 1 (fastest) to 9 (smallest).
+    int compression_level = 6;
+    // Add the time spent and bytes written to the global stats, as while profiling is enabled globally.
+    bool profile = false;
+    // Most bytes to hold while interleaving rows, or zero for kWriteChunkBytes.
+    int64_t max_memory = 0;
+    // "binary" or "ascii".
+    std::string format = "binary";
+    // Byte order of binary data: "native", "little" or "big".
+    std::string endianness = "native";
+    // Type of list lengths: "uchar", "ushort", "uint", or "auto" for the
+    // smallest that holds the longest list of each property.
+    std::string list_count_type = "auto";
+    // Significant digits of floating-point values written as text, or zero
+    // for the fewest that read back as the same value.
+    int precision = 0;
+    // "buffered" to interleave rows into a buffer written to the file a chunk
+    // at a time, "mmap" to size the file up front and interleave them into a
+    // mapping of it, or "auto" to map large uncompressed binary files.
+    std::string strategy = "auto";
+    // Return once the file is on stable storage (fdatasync).
+    bool sync = false;
+    // Leave room in the header for the row count of the last element to
+    // grow, so that rows can be appended to it in place (see append_ply).
+    bool appendable = false;
+};
 
-    for (const auto &[element_name, element]: elements) {
-        std::vector<char *> src_ptrs(element.size());
-        std::vector<uint32_t> strides(element.size());
-        std::vector<char> is_list(element.size());
-        std::vector<char> list_sizes(element.size(), 0);
+// Rows are interleaved into a buffer of about this size before being written to a file.
+constexpr int64_t kWriteChunkBytes = 16 << 20;
 
-        uint32_t num_rows = element.begin()->second.size(0);
+// Smaller files are written as fast through a buffer as they are mapped.
+constexpr int64_t kMapWriteMinBytes = 64 << 20;
 
-        int i = 0;
-        for (const auto &[property_name, data]: element) {
-            src_ptrs[i] = (char *) data.data_ptr();
-            strides[i] = get_torch_dtype_size(data.scalar_type());
-            is_list[i] = char((data.ndimension() > 1) && (data.size(1) > 1));
-            if (is_list[i]) {
-                list_sizes[i] = data.size(1);
+bool write_ply(const std::string& path, const WriteElementsType& elements, const WriteOptions& options) {
+    RECORD_FUNCTION("plytorch::write_ply", std::vector<c10::IValue>({c10::IValue(path)}));
+    PLYStats stats;
+    PLYStats* profile = (options.profile || profiling_enabled()) ? &stats : nullptr;
+    std::optional<PLYStatsTimer> total_timer(std::in_place, profile, &PLYStats::total_ns);
+    std::vector<PLYWriteElement> write_elements = make_write_elements(elements, options.list_count_type);
+    PLYWriteFormat format = parse_write_format(options.format);
+    PLYByteOrder byte_order = parse_byte_order(options.endianness);
+
+    if (options.strategy != "auto" && options.strategy != "buffered" && options.strategy != "mmap") {
+        throw std::runtime_error("unknown write strategy '" + options.strategy +
+                                 "', expected one of auto, buffered, mmap");
+    }
+    bool mappable = !options.compress && format == PLYWriteFormat::Binary;
+    if (options.strategy == "mmap" && !mappable) {
+        throw std::runtime_error("only uncompressed binary files can be written through a memory mapping");
+    }
+    if (mappable && options.strategy != "buffered") {
+        // The exact size is known up front, so the file can be sized first
+        // and filled in place.
+        std::string header = ply_header(write_elements, format, byte_order, options.appendable);
+        int64_t size = int64_t(header.size()) + ply_body_size(write_elements);
+        bool mapped = false;
+        if (options.strategy == "mmap" || size >= kMapWriteMinBytes) {
+            PLYStatsTimer timer(profile, &PLYStats::interleave_ns);
+            mapped = write_ply_mapped(path, header, write_elements, byte_order, options.sync);
+        }
+        if (options.strategy == "mmap" && !mapped) {
+            throw std::runtime_error("Could not map for writing: " + path);
+        }
+        if (mapped) {
+            if (profile != nullptr) {
+                total_timer.reset();
+                stats.calls = 1;
+                stats.mapped_writes = 1;
+                stats.bytes_written = size;
+                stats.copied_bytes = size;
+                add_global_stats(stats);
             }
-            ++i;
-        }
-
-        for (uint32_t el_idx = 0; el_idx != num_rows; ++el_idx) {
-            for (uint32_t prop_idx = 0; prop_idx != element.size(); ++prop_idx) {
-                uint32_t cur_stride = strides[prop_idx];
-                if (is_list[prop_idx] == 0) {
-                    mesh_file.write(src_ptrs[prop_idx], cur_stride);
-                    src_ptrs[prop_idx] += cur_stride;
-                } else {
-                    mesh_file.write(&list_sizes[prop_idx], 1);
-                    mesh_file.write(src_ptrs[prop_idx], cur_stride * list_sizes[prop_idx]);
-                    src_ptrs[prop_idx] += cur_stride * list_sizes[prop_idx];
+            return true;
+        }
+    }
+
+    std::ofstream mesh_file(path, std::ios::binary | std::ios::out);
+    if (!mesh_file.is_open()) {
+        throw std::runtime_error("Could not create file: " + path);
+    }
+
+    std::unique_ptr<BlockedGzipWriter> gzip_writer;
+    if (options.compress) {
+        gzip_writer = std::make_unique<BlockedGzipWriter>(mesh_file, options.compression_level);
+    }
+    auto emit = [&](const char* data, size_t size) {
+        if (gzip_writer) {
+            PLYStatsTimer timer(profile, &PLYStats::compress_ns);
+            gzip_writer->write(data, size);
+        } else {
+            PLYStatsTimer timer(profile, &PLYStats::write_ns);
+            mesh_file.write(data, size);
+        }
+    };
+
+    std::string header = ply_header(write_elements, format, byte_order, options.appendable);
+    emit(header.data(), header.size());
+
+    int64_t chunk_bytes = options.max_memory > 0 ? std::min(kWriteChunkBytes, options.max_memory) : kWriteChunkBytes;
+    std::vector<char> chunk;
+    std::string text;
+    for (const PLYWriteElement& element : write_elements) {
+        RECORD_FUNCTION("plytorch::write_element", std::vector<c10::IValue>({c10::IValue(element.name),
+                        c10::IValue(element.count), c10::IValue(ply_rows_size(element, 0, element.count))}));
+        if (format == PLYWriteFormat::ASCII) {
+            // Chunks are sized for the longest text rows can take.
+            for (int64_t row = 0, row_end; row < element.count; row = row_end) {
+                row_end = ply_chunk_end(element, row, chunk_bytes, format);
+                size_t capacity = text.capacity();
+                text.clear();
+                {
+                    PLYStatsTimer timer(profile, &PLYStats::interleave_ns);
+                    format_ply_rows(element, row, row_end, options.precision, text);
+                }
+                if (text.capacity() > capacity) {
+                    stats.allocations++;
+                    stats.allocated_bytes += int64_t(text.capacity());
                 }
+                stats.copied_bytes += int64_t(text.size());
+                emit(text.data(), text.size());
             }
+            continue;
+        }
+        for (int64_t row = 0, row_end; row < element.count; row = row_end) {
+            row_end = ply_chunk_end(element, row, chunk_bytes, format);
+            size_t size = size_t(ply_rows_size(element, row, row_end));
+            if (size > chunk.capacity()) {
+                stats.allocations++;
+                stats.allocated_bytes += int64_t(size);
+            }
+            chunk.resize(size);
+            stats.copied_bytes += int64_t(size);
+            {
+                PLYStatsTimer timer(profile, &PLYStats::interleave_ns);
+                write_ply_rows(element, row, row_end, chunk.data(), byte_order);
+            }
+            emit(chunk.data(), chunk.size());
         }
     }
 
-    mesh_file.close();
+    if (gzip_writer) {
+        PLYStatsTimer timer(profile, &PLYStats::compress_ns);
+        gzip_writer->finish();
+    }
+    stats.bytes_written = int64_t(mesh_file.tellp());
+    stats.peak_transient_bytes = int64_t(std::max(chunk.capacity(), text.capacity()));
+    {
+        PLYStatsTimer timer(profile, &PLYStats::write_ns);
+        mesh_file.close();
+    }
+    if (!mesh_file) {
+        throw std::runtime_error("Failed to write: " + path);
+    }
+    if (options.sync) {
+        PLYStatsTimer timer(profile, &PLYStats::write_ns);
+        sync_file(path);
+    }
+    if (profile != nullptr) {
+        total_timer.reset();
+        stats.calls = 1;
+        add_global_stats(stats);
+    }
     return true;
 }
 
+// Size in bytes of `elements` written as a binary PLY file, in the byte order
+// `endianness` (the name of big-endian data is three characters shorter).
+int64_t ply_size(const WriteElementsType& elements, const std::string& endianness) {
+    std::vector<PLYWriteElement> write_elements = make_write_elements(elements);
+    PLYByteOrder byte_order = parse_byte_order(endianness);
+    return int64_t(ply_header(write_elements, PLYWriteFormat::Binary, byte_order).size()) +
+           ply_body_size(write_elements);
+}
+
+// Writes `header` and the body of `write_elements` in `byte_order` to `dest`,
+// which must have room for both. Added to the global stats while profiling is
+// enabled.
+void serialize_ply(const std::vector<PLYWriteElement>& write_elements, const std::string& header,
+                   PLYByteOrder byte_order, char* dest) {
+    RECORD_FUNCTION("plytorch::dumps_ply", std::vector<c10::IValue>({c10::IValue(int64_t(header.size()) +
+                                                                                   ply_body_size(write_elements))}));
+    PLYStats stats;
+    PLYStats* profile = profiling_enabled() ? &stats : nullptr;
+    {
+        PLYStatsTimer total_timer(profile, &PLYStats::total_ns);
+        PLYStatsTimer timer(profile, &PLYStats::interleave_ns);
+        std::memcpy(dest, header.data(), header.size());
+        write_ply_body(write_elements, dest + header.size(), byte_order);
+    }
+    if (profile != nullptr) {
+        stats.calls = 1;
+        stats.bytes_written = int64_t(header.size()) + ply_body_size(write_elements);
+        stats.copied_bytes = stats.bytes_written;
+        add_global_stats(stats);
+    }
+}
+
+// Serializes `elements` into a bytes object, allocated once at its final size
+// and filled in place. `endianness` is as in WriteOptions.
+py::bytes dumps_ply(const WriteElementsType& elements, const std::string& endianness) {
+    PLYByteOrder byte_order = parse_byte_order(endianness);
+    std::vector<PLYWriteElement> write_elements = make_write_elements(elements);
+    std::string header = ply_header(write_elements, PLYWriteFormat::Binary, byte_order);
+    int64_t size = int64_t(header.size()) + ply_body_size(write_elements);
+
+    py::bytes result(nullptr, size_t(size));
+    serialize_ply(write_elements, header, byte_order, PyBytes_AS_STRING(result.ptr()));
+    return result;
+}
+
+// Serializes `elements` into the start of `out`, a writable contiguous
+// buffer. Returns the number of bytes written.
+int64_t dumps_ply_into(const WriteElementsType& elements, const py::buffer& out, const std::string& endianness) {
+    py::buffer_info info = out.request(true);
+    size_t capacity = contiguous_buffer_size(info);
+
+    PLYByteOrder byte_order = parse_byte_order(endianness);
+    std::vector<PLYWriteElement> write_elements = make_write_elements(elements);
+    std::string header = ply_header(write_elements, PLYWriteFormat::Binary, byte_order);
+    int64_t size = int64_t(header.size()) + ply_body_size(write_elements);
+    if (int64_t(capacity) < size) {
+        throw std::runtime_error("buffer of " + std::to_string(capacity) + " bytes is too small for " +
+                                 std::to_string(size) + " bytes of PLY data");
+    }
+
+    serialize_ply(write_elements, header, byte_order, static_cast<char*>(info.ptr));
+    return size;
+}
+
+// Overwrites property `name` of `element` in the binary PLY file at `path`
+// with `values`, one per row, without rewriting the rest of the file.
+void update_property(const std::string& path, const std::string& element, const std::string& name,
+                     const torch::Tensor& values) {
+    RECORD_FUNCTION("plytorch::update_property", std::vector<c10::IValue>({c10::IValue(path), c10::IValue(name)}));
+    if (values.ndimension() == 2 && values.size(1) != 1) {
+        throw std::runtime_error("property '" + name + "' takes one value per row, got " +
+                                 std::to_string(values.size(1)));
+    }
+    std::vector<PLYWriteElement> write_elements = make_write_elements({{element, {{name, values}}}});
+    const PLYWriteElement& write_element = write_elements.front();
+    update_ply_property(path, element, write_element.properties.front(), write_element.count);
+}
+
+// Appends rows to `element`, the last element of the PLY file at `path`,
+// writing only the new rows and the row count in the header. Returns the new
+// row count.
+int64_t append_ply(const std::string& path, const std::string& element,
+                   const std::vector<std::pair<std::string, WritePropertyData>>& properties) {
+    RECORD_FUNCTION("plytorch::append_ply", std::vector<c10::IValue>({c10::IValue(path)}));
+    std::vector<PLYWriteElement> write_elements = make_write_elements({{element, properties}});
+    return append_ply_rows(path, write_elements.front());
+}
+
 
 std::pair<torch::Tensor, std::vector<std::string>> read_float_ply(const std::string& path) {
     miniply::PLYReader reader(path.c_str());
@@ -248,7 +1637,9 @@ std::pair<torch::Tensor, std::vector<std::string>> read_float_ply(const std::str
 void write_float_ply(
         const std::string& path,
         const torch::Tensor& data,
-        const std::vector<std::string>& props
+        const std::vector<std::string>& props,
+        const std::string& format,
+        int precision
 )
 {
     std::ofstream of(path, std::ios::binary);
@@ -268,6 +1659,38 @@ void write_float_ply(
         throw std::runtime_error("data dtype must be float32");
     }
 
+    // Columns of `data`, for the text and for non-contiguous tensors.
+    PLYWriteElement element;
+    element.name = "vertex";
+    element.count = data.size(0);
+    for (size_t i = 0; i != props.size(); ++i) {
+        PLYWriteProperty property;
+        property.name = props[i];
+        property.type = "float";
+        property.value_size = 4;
+        property.data = reinterpret_cast<const char*>(static_cast<const float*>(data.data_ptr()) + i * data.stride(1));
+        property.stride = data.stride(0) * 4;
+        element.properties.push_back(property);
+    }
+
+    if (parse_write_format(format) == PLYWriteFormat::ASCII) {
+        std::string header = ply_header({element}, PLYWriteFormat::ASCII);
+        of.write(header.data(), header.size());
+
+        std::string text;
+        for (int64_t row = 0, row_end; row < element.count; row = row_end) {
+            row_end = ply_chunk_end(element, row, kWriteChunkBytes, PLYWriteFormat::ASCII);
+            text.clear();
+            format_ply_rows(element, row, row_end, precision, text);
+            of.write(text.data(), text.size());
+        }
+        of.close();
+        if (!of) {
+            throw std::runtime_error("Failed to write: " + path);
+        }
+        return;
+    }
+
     of << "ply" << std::endl <<
           "format binary_little_endian 1.0"<< std::endl <<
           "element vertex " << data.size(0) << std::endl;
@@ -277,14 +1700,119 @@ void write_float_ply(
     }
     of << "end_header" << std::endl;
 
-    size_t data_size = 4 * data.size(0) * data.size(1);
-    of.write(static_cast<const char *>(data.data_ptr()), data_size);
+    if (data.is_contiguous()) {
+        size_t data_size = 4 * data.size(0) * data.size(1);
+        of.write(static_cast<const char *>(data.data_ptr()), data_size);
+    } else {
+        // Gathered a chunk of rows at a time rather than copied whole.
+        std::vector<char> chunk;
+        for (int64_t row = 0, row_end; row < element.count; row = row_end) {
+            row_end = ply_chunk_end(element, row, kWriteChunkBytes, PLYWriteFormat::Binary);
+            chunk.resize(size_t(ply_rows_size(element, row, row_end)));
+            write_ply_rows(element, row, row_end, chunk.data());
+            of.write(chunk.data(), chunk.size());
+        }
+    }
     of.close();
 }
 
+py::dict stats_dict(const PLYStats& stats) {
+    py::dict result;
+    for (const auto& [name, value] : stats.items()) {
+        result[py::str(name)] = py::int_(value);
+    }
+    return result;
+}
+
+py::dict plan_dict(const ReadPlan& plan) {
+    py::dict result;
+    result["strategy"] = py::str(read_strategy_name(plan.strategy));
+    result["threads"] = py::int_(plan.threads);
+    result["reason"] = py::str(plan.reason);
+    result["file_size"] = py::int_(plan.storage.file_size);
+    result["resident_fraction"] = plan.storage.resident_fraction >= 0.0 ? py::object(py::float_(plan.storage.resident_fraction))
+                                                                        : py::object(py::none());
+    result["filesystem"] = py::str(plan.storage.filesystem);
+    result["remote"] = py::bool_(plan.storage.remote);
+    return result;
+}
+
 PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
+    set_parallel_backend(aten_parallel_backend());
+    set_parallel_chunk_runner_factory(&traced_chunk_runner);
+
     m.def("read_float_ply", &read_float_ply, "Read gaussian point cloud PLY file");
-    m.def("write_float_ply", &write_float_ply, "Write gaussian point cloud PLY file");
-    m.def("read_ply", &read_ply, "Read generic PLY file");
-    m.def("write_ply", &write_ply, "Write generic PLY file");
+    m.def("write_float_ply", &write_float_ply, "Write gaussian point cloud PLY file", py::arg("path"),
+          py::arg("data"), py::arg("props"), py::arg("format") = "binary", py::arg("precision") = 0);
+    py::class_<ReadOptions>(m, "ReadOptions")
+        .def(py::init<>())
+        .def_readwrite("index_dtype", &ReadOptions::index_dtype)
+        .def_readwrite("validate_indices", &ReadOptions::validate_indices)
+        .def_readwrite("weld_epsilon", &ReadOptions::weld_epsilon)
+        .def_readwrite("compute_normals", &ReadOptions::compute_normals)
+        .def_readwrite("vertex_face_adjacency", &ReadOptions::vertex_face_adjacency)
+        .def_readwrite("profile", &ReadOptions::profile)
+        .def_readwrite("max_memory", &ReadOptions::max_memory)
+        .def_readwrite("strategy", &ReadOptions::strategy)
+        .def_readwrite("threads", &ReadOptions::threads);
+    py::class_<ReadResult>(m, "ReadResult")
+        .def_readonly("elements", &ReadResult::elements)
+        .def_readonly("extras", &ReadResult::extras)
+        .def_property_readonly("stats", [](const ReadResult& result) -> py::object {
+            if (!result.stats) {
+                return py::none();
+            }
+            return stats_dict(*result.stats);
+        })
+        .def_property_readonly("plan", [](const ReadResult& result) -> py::object {
+            if (!result.plan) {
+                return py::none();
+            }
+            return plan_dict(*result.plan);
+        });
+    m.def("read_ply", &read_ply, "Read generic PLY file", py::arg("path"), py::arg("options") = ReadOptions());
+    m.def("read_ply_buffer", &read_ply_buffer, "Read generic PLY data from a buffer", py::arg("data"),
+          py::arg("options") = ReadOptions());
+    py::class_<PLYFollowIterator>(m, "PLYFollowIterator")
+        .def(py::init<const std::string&>(), py::arg("path"))
+        .def("wait", &PLYFollowIterator::wait, py::arg("timeout"))
+        .def("read", &PLYFollowIterator::read, py::arg("max_rows") = -1)
+        .def_property_readonly("element", &PLYFollowIterator::element)
+        .def_property_readonly("header_count", &PLYFollowIterator::header_count)
+        .def_property_readonly("rows_read", &PLYFollowIterator::rows_read);
+    py::class_<TarPLYIterator>(m, "TarPLYIterator")
+        .def(py::init<const std::string&, std::vector<std::string>>(), py::arg("path"), py::arg("patterns"))
+        .def("next", &TarPLYIterator::next)
+        .def("read", &TarPLYIterator::read, py::arg("options") = ReadOptions());
+    m.def("read_ply_stream", &read_ply_stream, "Read generic PLY data through a readinto callable", py::arg("readinto"),
+          py::arg("options") = ReadOptions());
+    py::class_<WriteOptions>(m, "WriteOptions")
+        .def(py::init<>())
+        .def_readwrite("compress", &WriteOptions::compress)
+        .def_readwrite("compression_level", &WriteOptions::compression_level)
+        .def_readwrite("profile", &WriteOptions::profile)
+        .def_readwrite("max_memory", &WriteOptions::max_memory)
+        .def_readwrite("format", &WriteOptions::format)
+        .def_readwrite("endianness", &WriteOptions::endianness)
+        .def_readwrite("list_count_type", &WriteOptions::list_count_type)
+        .def_readwrite("precision", &WriteOptions::precision)
+        .def_readwrite("strategy", &WriteOptions::strategy)
+        .def_readwrite("sync", &WriteOptions::sync)
+        .def_readwrite("appendable", &WriteOptions::appendable);
+    m.def("write_ply", &write_ply, "Write generic PLY file", py::arg("path"), py::arg("elements"),
+          py::arg("options") = WriteOptions());
+    m.def("ply_size", &ply_size, "Size in bytes of generic PLY data once written", py::arg("elements"),
+          py::arg("endianness") = "native");
+    m.def("dumps_ply", &dumps_ply, "Write generic PLY data to bytes", py::arg("elements"),
+          py::arg("endianness") = "native");
+    m.def("dumps_ply_into", &dumps_ply_into, "Write generic PLY data into a writable buffer", py::arg("elements"),
+          py::arg("out"), py::arg("endianness") = "native");
+    m.def("update_property", &update_property, "Overwrite a property of a binary PLY file in place",
+          py::arg("path"), py::arg("element"), py::arg("name"), py::arg("values"));
+    m.def("append_ply", &append_ply, "Append rows to the last element of a PLY file in place", py::arg("path"),
+          py::arg("element"), py::arg("properties"));
+    m.def("set_profiling", &set_profiling, "Profile every read and write", py::arg("enabled"));
+    m.def("profiling_enabled", &profiling_enabled, "Whether every read and write is profiled");
+    m.def("stats", [](bool reset) { return stats_dict(global_stats(reset)); },
+          "Totals over all profiled reads and writes", py::arg("reset") = false);
 }
\ No newline at end of file
@@ -0,0 +1,323 @@
+#include "mesh_ops.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+
+#include "parallel.h"
+
+
+namespace {
+
+constexpr int64_t kVertexGrainSize = 1 << 14;
+
+// Upper bound for the memory taken by the per-thread normal sums.
+constexpr int64_t kMaxNormalBufferBytes = int64_t(512) << 20;
+
+struct GridCell {
+    int64_t x, y, z;
+    int64_t vertex = -1;  // For vertices that aren't on the grid, the vertex alone in the cell.
+
+    bool operator==(const GridCell& other) const {
+        return x == other.x && y == other.y && z == other.z && vertex == other.vertex;
+    }
+};
+
+// Index along one axis of the grid cell `value` falls into. Returns false if
+// there is none: for NaN, infinity, or a cell index out of the int64 range.
+inline bool grid_index(double value, double epsilon, int64_t& index) {
+    double cell = std::floor(value / epsilon);
+    if (!(cell >= -0x1p63 && cell < 0x1p63)) {
+        return false;
+    }
+    index = int64_t(cell);
+    return true;
+}
+
+inline uint64_t hash_cell(const GridCell& cell) {
+    uint64_t h = uint64_t(cell.x) * 0x9E3779B97F4A7C15ull;
+    h ^= uint64_t(cell.y) * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+    h ^= uint64_t(cell.z) * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+    h ^= uint64_t(cell.vertex) + (h << 6) + (h >> 2);
+    // splitmix64 finalizer, spreads the bits over the low end used for the slot.
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+
+// out[i] = values[0] + ... + values[i - 1] for i in [0, n], summed per block
+// of `kVertexGrainSize` values in parallel.
+template <class T>
+void exclusive_scan(const T* values, int64_t n, int64_t* out) {
+    const int64_t num_blocks = std::max<int64_t>(1, (n + kVertexGrainSize - 1) / kVertexGrainSize);
+    std::vector<int64_t> block_sums(num_blocks + 1, 0);
+    parallel_for(0, num_blocks, 1, [&](int64_t block_begin, int64_t block_end) {
+        for (int64_t block = block_begin; block != block_end; ++block) {
+            int64_t sum = 0;
+            for (int64_t i = block * kVertexGrainSize, end = std::min(n, i + kVertexGrainSize); i < end; ++i) {
+                sum += int64_t(values[i]);
+            }
+            block_sums[block + 1] = sum;
+        }
+    });
+    for (int64_t block = 0; block != num_blocks; ++block) {
+        block_sums[block + 1] += block_sums[block];
+    }
+    parallel_for(0, num_blocks, 1, [&](int64_t block_begin, int64_t block_end) {
+        for (int64_t block = block_begin; block != block_end; ++block) {
+            int64_t sum = block_sums[block];
+            for (int64_t i = block * kVertexGrainSize, end = std::min(n, i + kVertexGrainSize); i < end; ++i) {
+                out[i] = sum;
+                sum += int64_t(values[i]);
+            }
+        }
+    });
+    out[n] = block_sums[num_blocks];
+}
+
+} // namespace
+
+
+template <class T>
+void weld_vertices(const T* x, const T* y, const T* z, int64_t n, double epsilon, int64_t* remap,
+                   std::vector<int64_t>& kept) {
+    kept.clear();
+    if (n == 0) {
+        return;
+    }
+
+    std::vector<GridCell> cells(n);
+    parallel_for(0, n, kVertexGrainSize, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i != end; ++i) {
+            GridCell& cell = cells[i];
+            if (!grid_index(double(x[i]), epsilon, cell.x) || !grid_index(double(y[i]), epsilon, cell.y) ||
+                !grid_index(double(z[i]), epsilon, cell.z)) {
+                cell = GridCell{0, 0, 0, i};
+            }
+        }
+    });
+
+    // Each slot holds the smallest index of the vertices in one cell, or -1.
+    uint64_t capacity = 16;
+    while (capacity < uint64_t(2 * n)) {
+        capacity <<= 1;
+    }
+    const uint64_t mask = capacity - 1;
+    std::unique_ptr<std::atomic<int64_t>[]> table(new std::atomic<int64_t>[capacity]);
+    parallel_for(0, int64_t(capacity), kVertexGrainSize, [&](int64_t begin, int64_t end) {
+        for (int64_t slot = begin; slot != end; ++slot) {
+            table[slot].store(-1, std::memory_order_relaxed);
+        }
+    });
+
+    auto find_slot = [&](int64_t i) {
+        uint64_t slot = hash_cell(cells[i]) & mask;
+        while (true) {
+            int64_t current = table[slot].load(std::memory_order_relaxed);
+            if (current == -1) {
+                if (table[slot].compare_exchange_weak(current, i, std::memory_order_relaxed)) {
+                    return slot;
+                }
+                continue; // somebody else took the slot, look at what they put there
+            }
+            if (cells[current] == cells[i]) {
+                while (i < current && !table[slot].compare_exchange_weak(current, i, std::memory_order_relaxed)) {
+                }
+                return slot;
+            }
+            slot = (slot + 1) & mask;
+        }
+    };
+
+    std::vector<int64_t> slots(n);
+    parallel_for(0, n, kVertexGrainSize, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i != end; ++i) {
+            slots[i] = int64_t(find_slot(i));
+        }
+    });
+
+    // The first vertex of a cell keeps its place, all others point at it.
+    // Survivors are numbered with a count / prefix-sum / assign pass over
+    // fixed blocks of vertices.
+    std::vector<int64_t>& representatives = slots; // each entry is replaced once its slot has been read
+    const int64_t num_blocks = (n + kVertexGrainSize - 1) / kVertexGrainSize;
+    std::vector<int64_t> block_offsets(num_blocks + 1, 0);
+    parallel_for(0, num_blocks, 1, [&](int64_t block_begin, int64_t block_end) {
+        for (int64_t block = block_begin; block != block_end; ++block) {
+            int64_t count = 0;
+            for (int64_t i = block * kVertexGrainSize, end = std::min(n, i + kVertexGrainSize); i != end; ++i) {
+                representatives[i] = table[slots[i]].load(std::memory_order_relaxed);
+                count += (representatives[i] == i);
+            }
+            block_offsets[block + 1] = count;
+        }
+    });
+    for (int64_t block = 0; block != num_blocks; ++block) {
+        block_offsets[block + 1] += block_offsets[block];
+    }
+
+    kept.resize(block_offsets[num_blocks]);
+    parallel_for(0, num_blocks, 1, [&](int64_t block_begin, int64_t block_end) {
+        for (int64_t block = block_begin; block != block_end; ++block) {
+            int64_t next = block_offsets[block];
+            for (int64_t i = block * kVertexGrainSize, end = std::min(n, i + kVertexGrainSize); i != end; ++i) {
+                if (representatives[i] == i) {
+                    remap[i] = next;
+                    kept[next++] = i;
+                }
+            }
+        }
+    });
+    parallel_for(0, n, kVertexGrainSize, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i != end; ++i) {
+            if (representatives[i] != i) {
+                remap[i] = remap[representatives[i]];
+            }
+        }
+    });
+}
+
+
+template <class Index>
+void build_vertex_face_adjacency(const Index* indices, const uint32_t* counts, int64_t num_faces, const int64_t* remap,
+                                 int64_t num_vertices, int64_t* offsets, int64_t* face_ids) {
+    std::vector<int64_t> face_starts(num_faces + 1);
+    exclusive_scan(counts, num_faces, face_starts.data());
+
+    auto vertex_at = [&](int64_t i) {
+        return remap != nullptr ? remap[int64_t(indices[i])] : int64_t(indices[i]);
+    };
+
+    // Count the faces around every vertex.
+    std::unique_ptr<std::atomic<int64_t>[]> cursors(new std::atomic<int64_t>[num_vertices]);
+    parallel_for(0, num_vertices, kVertexGrainSize, [&](int64_t begin, int64_t end) {
+        for (int64_t v = begin; v != end; ++v) {
+            cursors[v].store(0, std::memory_order_relaxed);
+        }
+    });
+    parallel_for(0, num_faces, kVertexGrainSize, [&](int64_t begin, int64_t end) {
+        for (int64_t i = face_starts[begin]; i != face_starts[end]; ++i) {
+            cursors[vertex_at(i)].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    // Turn the counts into offsets, which then serve as insertion cursors.
+    std::vector<int64_t> vertex_counts(num_vertices);
+    parallel_for(0, num_vertices, kVertexGrainSize, [&](int64_t begin, int64_t end) {
+        for (int64_t v = begin; v != end; ++v) {
+            vertex_counts[v] = cursors[v].load(std::memory_order_relaxed);
+        }
+    });
+    exclusive_scan(vertex_counts.data(), num_vertices, offsets);
+    parallel_for(0, num_vertices, kVertexGrainSize, [&](int64_t begin, int64_t end) {
+        for (int64_t v = begin; v != end; ++v) {
+            cursors[v].store(offsets[v], std::memory_order_relaxed);
+        }
+    });
+
+    parallel_for(0, num_faces, kVertexGrainSize, [&](int64_t begin, int64_t end) {
+        for (int64_t f = begin; f != end; ++f) {
+            for (int64_t i = face_starts[f]; i != face_starts[f + 1]; ++i) {
+                face_ids[cursors[vertex_at(i)].fetch_add(1, std::memory_order_relaxed)] = f;
+            }
+        }
+    });
+
+    // Concurrent scatter leaves each vertex's faces in arbitrary order.
+    parallel_for(0, num_vertices, kVertexGrainSize, [&](int64_t begin, int64_t end) {
+        for (int64_t v = begin; v != end; ++v) {
+            std::sort(face_ids + offsets[v], face_ids + offsets[v + 1]);
+        }
+    });
+}
+
+
+VertexNormalAccumulator::VertexNormalAccumulator(const float* positions, int64_t num_vertices, int64_t num_buffers)
+    : m_positions(positions), m_numVertices(num_vertices) {
+    int64_t buffer_bytes = std::max<int64_t>(num_vertices * 3 * int64_t(sizeof(float)), 1);
+    num_buffers = std::max<int64_t>(1, std::min(num_buffers, kMaxNormalBufferBytes / buffer_bytes));
+    m_sums.resize(num_buffers);
+    parallel_for(0, num_buffers, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t buffer = begin; buffer != end; ++buffer) {
+            m_sums[buffer].assign(3 * num_vertices, 0.0f);
+        }
+    });
+}
+
+
+int64_t VertexNormalAccumulator::num_buffers() const {
+    return int64_t(m_sums.size());
+}
+
+
+template <class Index>
+void VertexNormalAccumulator::add_faces(int64_t buffer, const Index* faces, int64_t num_faces, int64_t face_size) {
+    if (face_size < 3) {
+        return;
+    }
+    float* sums = m_sums[buffer].data();
+    const float* pos = m_positions;
+
+    for (int64_t f = 0; f != num_faces; ++f) {
+        const Index* face = faces + f * face_size;
+        const float* p0 = pos + 3 * int64_t(face[0]);
+
+        float n[3] = {0.0f, 0.0f, 0.0f};
+        for (int64_t k = 1; k + 1 < face_size; ++k) {
+            const float* p1 = pos + 3 * int64_t(face[k]);
+            const float* p2 = pos + 3 * int64_t(face[k + 1]);
+            float u[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            float v[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            n[0] += u[1] * v[2] - u[2] * v[1];
+            n[1] += u[2] * v[0] - u[0] * v[2];
+            n[2] += u[0] * v[1] - u[1] * v[0];
+        }
+
+        for (int64_t k = 0; k != face_size; ++k) {
+            float* sum = sums + 3 * int64_t(face[k]);
+            sum[0] += n[0];
+            sum[1] += n[1];
+            sum[2] += n[2];
+        }
+    }
+}
+
+
+void VertexNormalAccumulator::finish(float* normals) const {
+    parallel_for(0, m_numVertices, kVertexGrainSize, [&](int64_t begin, int64_t end) {
+        for (int64_t v = begin; v != end; ++v) {
+            float n[3] = {0.0f, 0.0f, 0.0f};
+            for (const std::vector<float>& sums : m_sums) {
+                n[0] += sums[3 * v];
+                n[1] += sums[3 * v + 1];
+                n[2] += sums[3 * v + 2];
+            }
+            float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            float scale = length > 0.0f ? 1.0f / length : 0.0f;
+            normals[3 * v] = n[0] * scale;
+            normals[3 * v + 1] = n[1] * scale;
+            normals[3 * v + 2] = n[2] * scale;
+        }
+    });
+}
+
+
+template void weld_vertices(const float*, const float*, const float*, int64_t, double, int64_t*,
+                            std::vector<int64_t>&);
+template void weld_vertices(const double*, const double*, const double*, int64_t, double, int64_t*,
+                            std::vector<int64_t>&);
+
+#define INSTANTIATE_FOR_INDEX(Index) \
+    template void build_vertex_face_adjacency(const Index*, const uint32_t*, int64_t, const int64_t*, int64_t, int64_t*, int64_t*); \
+    template void VertexNormalAccumulator::add_faces(int64_t, const Index*, int64_t, int64_t);
+
+INSTANTIATE_FOR_INDEX(int8_t)
+INSTANTIATE_FOR_INDEX(uint8_t)
+INSTANTIATE_FOR_INDEX(int16_t)
+INSTANTIATE_FOR_INDEX(uint16_t)
+INSTANTIATE_FOR_INDEX(int32_t)
+INSTANTIATE_FOR_INDEX(uint32_t)
+INSTANTIATE_FOR_INDEX(int64_t)
+
+#undef INSTANTIATE_FOR_INDEX
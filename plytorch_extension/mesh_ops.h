@@ -0,0 +1,58 @@
+#ifndef PLYTORCH_MESH_OPS_H
+#define PLYTORCH_MESH_OPS_H
+
+#include <cstdint>
+#include <vector>
+
+
+// Merges vertices whose positions fall into the same cell of a grid with
+// spacing `epsilon`. `x`, `y` and `z` hold the coordinates of the `n`
+// vertices, as float or double. On return `remap[i]`
+// is the new index of vertex `i`, and `kept` lists, in increasing order, the
+// original index of every surviving vertex (the first vertex of each cell).
+// Vertices with a non-finite coordinate, or too far out for the grid, are
+// kept as they are, without being merged with any other.
+// Cells are looked up in a concurrent open-addressing hash table, so the
+// result doesn't depend on the number of threads.
+template <class T>
+void weld_vertices(const T* x, const T* y, const T* z, int64_t n, double epsilon, int64_t* remap,
+                   std::vector<int64_t>& kept);
+
+// Builds vertex -> face adjacency in CSR form: the faces around vertex `v` are
+// `face_ids[offsets[v]]` to `face_ids[offsets[v + 1] - 1]`, in increasing
+// order. `indices` holds the vertex lists of `num_faces` faces back to back and
+// `counts` the length of each list. Indices are replaced by their `remap` entry
+// first, if given, and must then be in [0, num_vertices). `offsets` needs
+// `num_vertices + 1` entries, `face_ids` one per index. Built with a parallel
+// count / prefix-sum / scatter pass.
+template <class Index>
+void build_vertex_face_adjacency(const Index* indices, const uint32_t* counts, int64_t num_faces, const int64_t* remap,
+                                 int64_t num_vertices, int64_t* offsets, int64_t* face_ids);
+
+// Accumulates area-weighted face normals into per-vertex sums. Each thread
+// adds faces to its own buffer; `finish` then reduces all buffers in parallel.
+// Polygons are treated as triangle fans, so every vertex of a face receives
+// the face normal scaled by twice the face area.
+class VertexNormalAccumulator {
+public:
+    // `positions` holds `num_vertices` xyz triples and must outlive the accumulator.
+    VertexNormalAccumulator(const float* positions, int64_t num_vertices, int64_t num_buffers);
+
+    int64_t num_buffers() const;
+
+    // Adds `num_faces` faces of `face_size` vertex indices each to buffer
+    // `buffer`. All indices must be in [0, num_vertices).
+    template <class Index>
+    void add_faces(int64_t buffer, const Index* faces, int64_t num_faces, int64_t face_size);
+
+    // Writes the normalized sum of all buffers into `normals`, `num_vertices`
+    // xyz triples. Vertices without faces get a zero normal.
+    void finish(float* normals) const;
+
+private:
+    const float* m_positions;
+    int64_t m_numVertices;
+    std::vector<std::vector<float>> m_sums;
+};
+
+#endif // PLYTORCH_MESH_OPS_H
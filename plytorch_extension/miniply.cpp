@@ -25,6 +25,7 @@ SOFTWARE.
 #include "miniply.h"
 
 #include <cassert>
+#include <chrono>
 #include <cctype>
 #include <cmath>
 #include <cstdarg>
@@ -196,6 +197,16 @@ namespace miniply {
   }
 
 
+  static inline int64_t file_tell(FILE* file)
+  {
+  #ifdef _WIN32
+    return _ftelli64(file);
+  #else
+    return static_cast<int64_t>(ftello(file));
+  #endif
+  }
+
+
   static bool int_literal(const char* start, char const** end, int* val)
   {
     const char* pos = start;
@@ -456,6 +467,55 @@ namespace miniply {
   }
 
 
+  //
+  // Profiling
+  //
+
+  static inline uint64_t now_ns()
+  {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+
+  namespace {
+
+    /// Adds the time between its construction and destruction to `phase` in
+    /// `stats`, less the time nested timers added to the other phases
+    /// meanwhile. Does nothing if `stats` is null.
+    class PLYPhaseTimer {
+    public:
+      PLYPhaseTimer(PLYReaderStats* stats, uint64_t PLYReaderStats::* phase) :
+        m_stats(stats),
+        m_phase(phase)
+      {
+        if (m_stats != nullptr) {
+          m_start = now_ns();
+          m_nestedStart = m_stats->total_ns();
+        }
+      }
+
+      ~PLYPhaseTimer()
+      {
+        if (m_stats != nullptr) {
+          uint64_t nested = m_stats->total_ns() - m_nestedStart;
+          m_stats->*m_phase += (now_ns() - m_start) - nested;
+        }
+      }
+
+      PLYPhaseTimer(const PLYPhaseTimer&) = delete;
+      PLYPhaseTimer& operator=(const PLYPhaseTimer&) = delete;
+
+    private:
+      PLYReaderStats* m_stats;
+      uint64_t PLYReaderStats::* m_phase;
+      uint64_t m_start       = 0;
+      uint64_t m_nestedStart = 0;
+    };
+
+  } // namespace
+
+
   //
   // PLYElement methods
   //
@@ -577,12 +637,173 @@ namespace miniply {
   }
 
 
+  //
+  // PLYSource methods
+  //
+
+  PLYSource::~PLYSource()
+  {
+  }
+
+
+  const uint8_t* PLYSource::data() const
+  {
+    return nullptr;
+  }
+
+
+  int64_t PLYSource::size() const
+  {
+    return -1;
+  }
+
+
+  bool PLYSource::seekable() const
+  {
+    return true;
+  }
+
+
+  PLYFileSource::PLYFileSource(FILE* f, bool closeWhenDone) :
+    m_f(f),
+    m_closeWhenDone(closeWhenDone)
+  {
+    // Pipes, sockets and terminals report no position. Offsets are relative
+    // to wherever the file was when handed over, e.g. for stdin.
+    m_start = file_tell(m_f);
+    m_seekable = m_start >= 0;
+  }
+
+
+  PLYFileSource::~PLYFileSource()
+  {
+    if (m_f != nullptr && m_closeWhenDone) {
+      fclose(m_f);
+    }
+  }
+
+
+  size_t PLYFileSource::read(void* dest, size_t size)
+  {
+    return fread(dest, sizeof(char), size, m_f);
+  }
+
+
+  bool PLYFileSource::seek(int64_t offset)
+  {
+    return m_seekable && file_seek(m_f, m_start + offset, SEEK_SET) == 0;
+  }
+
+
+  bool PLYFileSource::seekable() const
+  {
+    return m_seekable;
+  }
+
+
+  PLYMemorySource::PLYMemorySource(const void* data, size_t size) :
+    m_data(reinterpret_cast<const uint8_t*>(data)),
+    m_size(size)
+  {
+  }
+
+
+  size_t PLYMemorySource::read(void* dest, size_t size)
+  {
+    size_t n = (size < m_size - m_pos) ? size : m_size - m_pos;
+    std::memcpy(dest, m_data + m_pos, n);
+    m_pos += n;
+    return n;
+  }
+
+
+  bool PLYMemorySource::seek(int64_t offset)
+  {
+    if (offset < 0 || static_cast<uint64_t>(offset) > m_size) {
+      return false;
+    }
+    m_pos = static_cast<size_t>(offset);
+    return true;
+  }
+
+
+  const uint8_t* PLYMemorySource::data() const
+  {
+    return m_data;
+  }
+
+
+  int64_t PLYMemorySource::size() const
+  {
+    return static_cast<int64_t>(m_size);
+  }
+
+
+  PLYCallbackSource::PLYCallbackSource(ReadFunc readFunc, SeekFunc seekFunc) :
+    m_readFunc(std::move(readFunc)),
+    m_seekFunc(std::move(seekFunc))
+  {
+  }
+
+
+  size_t PLYCallbackSource::read(void* dest, size_t size)
+  {
+    // The reader takes a short read to mean the end of the data, so keep
+    // asking until the callback has nothing more to give.
+    uint8_t* to = reinterpret_cast<uint8_t*>(dest);
+    size_t total = 0;
+    while (total < size) {
+      size_t n = m_readFunc(to + total, size - total);
+      if (n == 0) {
+        break;
+      }
+      total += n;
+    }
+    return total;
+  }
+
+
+  bool PLYCallbackSource::seek(int64_t offset)
+  {
+    return m_seekFunc ? m_seekFunc(offset) : false;
+  }
+
+
+  bool PLYCallbackSource::seekable() const
+  {
+    return static_cast<bool>(m_seekFunc);
+  }
+
+
   //
   // PLYReader methods
   //
 
-  PLYReader::PLYReader(const char* filename)
+  std::unique_ptr<PLYSource> open_file_source(const char* filename)
   {
+    if (std::strcmp(filename, "-") == 0) {
+      return std::unique_ptr<PLYSource>(new PLYFileSource(stdin, false));
+    }
+    FILE* f = nullptr;
+    if (file_open(&f, filename, "rb") != 0 || f == nullptr) {
+      return nullptr;
+    }
+    return std::unique_ptr<PLYSource>(new PLYFileSource(f));
+  }
+
+
+  PLYReader::PLYReader(const char* filename) :
+    PLYReader(open_file_source(filename))
+  {
+  }
+
+
+  PLYReader::PLYReader(std::unique_ptr<PLYSource> source, PLYReaderStats* stats) :
+    m_source(std::move(source)),
+    m_stats(stats)
+  {
+    PLYPhaseTimer timer(m_stats, &PLYReaderStats::headerNs);
+
     m_buf = new char[kPLYReadBufferSize + 1];
     m_buf[kPLYReadBufferSize] = '\0';
 
@@ -593,8 +814,7 @@ namespace miniply {
     m_pos = m_bufEnd;
     m_end = m_bufEnd;
 
-    if (file_open(&m_f, filename, "rb") != 0) {
-      m_f = nullptr;
+    if (m_source == nullptr) {
       m_valid = false;
       return;
     }
@@ -617,6 +837,9 @@ namespace miniply {
     if (m_fileType == PLYFileType::ASCII) {
       advance();
     }
+    else {
+      m_dataOffset = m_bufOffset + static_cast<int64_t>(m_pos - m_buf);
+    }
 
     for (PLYElement& elem : m_elements) {
       elem.calculate_offsets();
@@ -626,9 +849,6 @@ namespace miniply {
 
   PLYReader::~PLYReader()
   {
-    if (m_f != nullptr) {
-      fclose(m_f);
-    }
     delete[] m_buf;
     delete[] m_tmpBuf;
   }
@@ -640,6 +860,12 @@ namespace miniply {
   }
 
 
+  bool PLYReader::seekable() const
+  {
+    return m_source != nullptr && m_source->seekable();
+  }
+
+
   bool PLYReader::has_element() const
   {
     return m_valid && m_currentElement < m_elements.size();
@@ -661,10 +887,48 @@ namespace miniply {
     }
 
     PLYElement& elem = m_elements[m_currentElement];
+    PLYPhaseTimer timer(m_stats, elem.fixedSize ? &PLYReaderStats::loadNs : &PLYReaderStats::listNs);
     return elem.fixedSize ? load_fixed_size_element(elem) : load_variable_size_element(elem);
   }
 
 
+  bool PLYReader::load_element_rows(uint32_t maxRows)
+  {
+    assert(has_element());
+    PLYElement& elem = m_elements[m_currentElement];
+    uint32_t nextRow = m_firstLoadedRow + m_loadedRows;
+    if (!elem.fixedSize || maxRows == 0 || nextRow >= elem.count) {
+      return false;
+    }
+
+    PLYPhaseTimer timer(m_stats, &PLYReaderStats::loadNs);
+    uint32_t numRows = (elem.count - nextRow < maxRows) ? (elem.count - nextRow) : maxRows;
+    if (!load_fixed_size_rows(elem, numRows)) {
+      return false;
+    }
+    m_firstLoadedRow = nextRow;
+    return true;
+  }
+
+
+  uint32_t PLYReader::loaded_rows() const
+  {
+    return m_loadedRows;
+  }
+
+
+  uint32_t PLYReader::first_loaded_row() const
+  {
+    return m_firstLoadedRow;
+  }
+
+
+  bool PLYReader::loads_in_place() const
+  {
+    return m_fileType == PLYFileType::Binary && m_source != nullptr && m_source->data() != nullptr;
+  }
+
+
   void PLYReader::next_element()
   {
     if (!has_element()) {
@@ -672,10 +936,11 @@ namespace miniply {
     }
 
     // If the element was loaded, the read buffer should already be positioned at
-    // the start of the next element.
+    // the start of the next element, or of its rows not loaded yet.
     PLYElement& elem = m_elements[m_currentElement];
     m_currentElement++;
 
+    uint32_t rowsLeft = elem.count;
     if (m_elementLoaded) {
       // Clear any temporary storage used for list properties in the current element.
       for (PLYProperty& prop : elem.properties) {
@@ -690,8 +955,15 @@ namespace miniply {
 
       // Clear temporary storage for the non-list properties in the current element.
       m_elementData.clear();
+      m_elementView = nullptr;
+      m_elementViewSize = 0;
       m_elementLoaded = false;
-      return;
+      rowsLeft = elem.count - (m_firstLoadedRow + m_loadedRows);
+      m_firstLoadedRow = 0;
+      m_loadedRows = 0;
+      if (rowsLeft == 0) {
+        return;
+      }
     }
 
     // If the element wasn't loaded, we have to move the file pointer past its
@@ -699,21 +971,16 @@ namespace miniply {
     // file and, if it's a binary, whether the element is fixed or variable
     // size.
     if (m_fileType == PLYFileType::ASCII) {
-      for (uint32_t row = 0; row < elem.count; row++) {
+      for (uint32_t row = 0; row < rowsLeft; row++) {
         next_line();
       }
     }
     else if (elem.fixedSize) {
       int64_t elementStart = static_cast<int64_t>(m_pos - m_buf);
-      int64_t elementSize = elem.rowStride * elem.count;
+      int64_t elementSize = static_cast<int64_t>(elem.rowStride) * rowsLeft;
       int64_t elementEnd = elementStart + elementSize;
       if (elementEnd >= kPLYReadBufferSize) {
-        m_bufOffset += elementEnd;
-        file_seek(m_f, m_bufOffset, SEEK_SET);
-        m_bufEnd = m_buf + kPLYReadBufferSize;
-        m_pos = m_bufEnd;
-        m_end = m_bufEnd;
-        refill_buffer();
+        seek_to(m_bufOffset + elementEnd);
       }
       else {
         m_pos = m_buf + elementEnd;
@@ -857,6 +1124,59 @@ namespace miniply {
   }
 
 
+  int64_t PLYReader::element_offset(uint32_t idx) const
+  {
+    if (idx >= num_elements() || m_dataOffset < 0) {
+      return -1;
+    }
+
+    int64_t offset = m_dataOffset;
+    for (uint32_t i = 0; i < idx; i++) {
+      const PLYElement& elem = m_elements[i];
+      if (!elem.fixedSize) {
+        return -1;
+      }
+      offset += static_cast<int64_t>(elem.rowStride) * elem.count;
+    }
+    return offset;
+  }
+
+
+  bool PLYReader::seek_element(uint32_t idx, int64_t offset)
+  {
+    if (!m_valid || idx >= m_elements.size() || offset < 0) {
+      return false;
+    }
+    if (idx == m_currentElement && !m_elementLoaded && offset == m_bufOffset + (m_pos - m_buf)) {
+      // Already there.
+      return true;
+    }
+
+    if (m_elementLoaded) {
+      // Release the data of the element we're leaving, the same way `next_element` would.
+      for (PLYProperty& prop : m_elements[m_currentElement].properties) {
+        prop.listData.clear();
+        prop.listData.shrink_to_fit();
+        prop.rowCount.clear();
+        prop.rowCount.shrink_to_fit();
+      }
+      m_elementData.clear();
+      m_elementView = nullptr;
+      m_elementViewSize = 0;
+      m_elementLoaded = false;
+      m_firstLoadedRow = 0;
+      m_loadedRows = 0;
+    }
+
+    m_currentElement = idx;
+    if (!seek_to(offset)) {
+      m_valid = false;
+      return false;
+    }
+    return true;
+  }
+
+
   bool PLYReader::element_is(const char* name) const
   {
     return has_element() && strcmp(element()->name.c_str(), name) == 0;
@@ -938,6 +1258,14 @@ namespace miniply {
       }
     }
 
+    PLYPhaseTimer timer(m_stats, conversionRequired ? &PLYReaderStats::convertNs : &PLYReaderStats::extractNs);
+    if (m_stats != nullptr) {
+      if (conversionRequired) {
+        m_stats->conversions += static_cast<uint64_t>(numProps) * m_loadedRows;
+      }
+      m_stats->copiedBytes += static_cast<uint64_t>(numProps) * m_loadedRows * kPLYPropertySize[uint32_t(destType)];
+    }
+
     uint8_t* to = reinterpret_cast<uint8_t*>(dest);
     if (!conversionRequired) {
       // If no data conversion is required, we can just use memcpy to get
@@ -946,13 +1274,13 @@ namespace miniply {
         // Most efficient case is when the rows are contiguous. It means we're
         // simply copying the entire data block for this element, which we can
         // do with a single memcpy.
-        std::memcpy(to, m_elementData.data(), m_elementData.size());
+        std::memcpy(to, m_elementView, m_elementViewSize);
       }
       else if (contiguousCols) {
         // If the rows aren't contiguous, but the columns we're extracting
         // within each row are, then we can do a single memcpy per row.
-        const uint8_t* from = m_elementData.data() + elem->properties[propIdxs[0]].offset;
-        const uint8_t* end = m_elementData.data() + m_elementData.size();
+        const uint8_t* from = m_elementView + elem->properties[propIdxs[0]].offset;
+        const uint8_t* end = m_elementView + m_elementViewSize;
         const size_t numBytes = expectedOffset - elem->properties[propIdxs[0]].offset;
         while (from < end) {
           std::memcpy(to, from, numBytes);
@@ -962,8 +1290,8 @@ namespace miniply {
       }
       else {
         // If the columns aren't contiguous, we must memcpy each one separately.
-        const uint8_t* row = m_elementData.data();
-        const uint8_t* end = m_elementData.data() + m_elementData.size();
+        const uint8_t* row = m_elementView;
+        const uint8_t* end = m_elementView + m_elementViewSize;
         uint8_t* to = reinterpret_cast<uint8_t*>(dest);
         size_t colBytes = kPLYPropertySize[uint32_t(destType)]; // size of an output column in bytes.
         while (row < end) {
@@ -981,8 +1309,8 @@ namespace miniply {
       // We will have to do data type conversions on the column values here. We
       // cannot simply use memcpy in this case, every column has to be
       // processed separately.
-      const uint8_t* row = m_elementData.data();
-      const uint8_t* end = m_elementData.data() + m_elementData.size();
+      const uint8_t* row = m_elementView;
+      const uint8_t* end = m_elementView + m_elementViewSize;
       uint8_t* to = reinterpret_cast<uint8_t*>(dest);
       size_t colBytes = kPLYPropertySize[uint32_t(destType)]; // size of an output column in bytes.
       while (row < end) {
@@ -1054,6 +1382,14 @@ namespace miniply {
       }
     }
 
+    PLYPhaseTimer timer(m_stats, conversionRequired ? &PLYReaderStats::convertNs : &PLYReaderStats::extractNs);
+    if (m_stats != nullptr) {
+      if (conversionRequired) {
+        m_stats->conversions += static_cast<uint64_t>(numProps) * m_loadedRows;
+      }
+      m_stats->copiedBytes += static_cast<uint64_t>(numProps) * m_loadedRows * kPLYPropertySize[uint32_t(destType)];
+    }
+
     uint8_t* to = reinterpret_cast<uint8_t*>(dest);
     if (!conversionRequired) {
       // If no data conversion is required, we can just use memcpy to get
@@ -1062,8 +1398,8 @@ namespace miniply {
       if (contiguousCols) {
         // If the rows aren't contiguous, but the columns we're extracting
         // within each row are, then we can do a single memcpy per row.
-        const uint8_t* from = m_elementData.data() + elem->properties[propIdxs[0]].offset;
-        const uint8_t* end = m_elementData.data() + m_elementData.size();
+        const uint8_t* from = m_elementView + elem->properties[propIdxs[0]].offset;
+        const uint8_t* end = m_elementView + m_elementViewSize;
         const size_t numBytes = expectedOffset - elem->properties[propIdxs[0]].offset;
         while (from < end) {
           std::memcpy(to, from, numBytes);
@@ -1073,8 +1409,8 @@ namespace miniply {
       }
       else {
         // If the columns aren't contiguous, we must memcpy each one separately.
-        const uint8_t* row = m_elementData.data();
-        const uint8_t* end = m_elementData.data() + m_elementData.size();
+        const uint8_t* row = m_elementView;
+        const uint8_t* end = m_elementView + m_elementViewSize;
         uint8_t* to = reinterpret_cast<uint8_t*>(dest);
         const size_t colBytes = kPLYPropertySize[uint32_t(destType)]; // size of an output column in bytes.
         const size_t colPadding = destStride - minDestStride;
@@ -1094,8 +1430,8 @@ namespace miniply {
       // We will have to do data type conversions on the column values here. We
       // cannot simply use memcpy in this case, every column has to be
       // processed separately.
-      const uint8_t* row = m_elementData.data();
-      const uint8_t* end = m_elementData.data() + m_elementData.size();
+      const uint8_t* row = m_elementView;
+      const uint8_t* end = m_elementView + m_elementViewSize;
       uint8_t* to = reinterpret_cast<uint8_t*>(dest);
       size_t colBytes = kPLYPropertySize[uint32_t(destType)]; // size of an output column in bytes.
       size_t colPadding = destStride - minDestStride;
@@ -1150,7 +1486,17 @@ namespace miniply {
     }
 
     const PLYProperty& prop = element()->properties[propIdx];
-    if (compatible_types(prop.type, destType)) {
+    const bool conversionRequired = !compatible_types(prop.type, destType);
+    PLYPhaseTimer timer(m_stats, conversionRequired ? &PLYReaderStats::convertNs : &PLYReaderStats::extractNs);
+    if (m_stats != nullptr) {
+      uint64_t numValues = prop.listData.size() / kPLYPropertySize[uint32_t(prop.type)];
+      if (conversionRequired) {
+        m_stats->conversions += numValues;
+      }
+      m_stats->copiedBytes += numValues * kPLYPropertySize[uint32_t(destType)];
+    }
+
+    if (!conversionRequired) {
       // If no type conversion is required, we can just copy the list data
       // directly over with a single memcpy.
       std::memcpy(dest, prop.listData.data(), prop.listData.size());
@@ -1228,6 +1574,11 @@ namespace miniply {
     size_t srcValBytes  = kPLYPropertySize[uint32_t(prop.type)];
     size_t destValBytes = kPLYPropertySize[uint32_t(destType)];
 
+    PLYPhaseTimer timer(m_stats, (convertSrc || convertDst) ? &PLYReaderStats::convertNs : &PLYReaderStats::extractNs);
+    if ((convertSrc || convertDst) && m_stats != nullptr) {
+      m_stats->conversions += prop.listData.size() / srcValBytes;
+    }
+
     if (convertSrc && convertDst) {
       std::vector<int> faceIndices, triIndices;
       faceIndices.reserve(32);
@@ -1337,7 +1688,7 @@ namespace miniply {
 
   bool PLYReader::refill_buffer()
   {
-    if (m_f == nullptr || m_atEOF) {
+    if (m_source == nullptr || m_atEOF) {
       // Nothing left to read.
       return false;
     }
@@ -1358,13 +1709,27 @@ namespace miniply {
     size_t keep = static_cast<size_t>(m_bufEnd - m_pos);
     if (keep > 0 && m_pos > m_buf) {
       std::memmove(m_buf, m_pos, sizeof(char) * keep);
-      m_bufOffset += static_cast<int64_t>(m_pos - m_buf);
+      if (m_stats != nullptr) {
+        m_stats->memmoves++;
+        m_stats->memmoveBytes += keep;
+      }
     }
     m_end = m_buf + (m_end - m_pos);
     m_pos = m_buf;
 
     // Fill the remaining space in the buffer with data from the file.
-    size_t fetched = fread(m_buf + keep, sizeof(char), kPLYReadBufferSize - keep, m_f) + keep;
+    size_t numRead = 0;
+    {
+      PLYPhaseTimer timer(m_stats, &PLYReaderStats::readNs);
+      numRead = m_source->read(m_buf + keep, kPLYReadBufferSize - keep);
+    }
+    if (m_stats != nullptr) {
+      m_stats->refills++;
+      m_stats->bytesRead += numRead;
+    }
+    size_t fetched = numRead + keep;
+    m_fileOffset += static_cast<int64_t>(numRead);
+    m_bufOffset = m_fileOffset - static_cast<int64_t>(fetched);
     m_atEOF = fetched < kPLYReadBufferSize;
     m_bufEnd = m_buf + fetched;
 
@@ -1375,6 +1740,71 @@ namespace miniply {
   }
 
 
+  bool PLYReader::seek_to(int64_t offset)
+  {
+    if (m_source == nullptr) {
+      return false;
+    }
+    if (!m_source->seekable()) {
+      return skip_to(offset);
+    }
+    if (!m_source->seek(offset)) {
+      return false;
+    }
+    m_fileOffset = offset;
+    m_bufOffset = offset;
+    m_atEOF = false;
+
+    // Discard the buffer contents, `refill_buffer` will start again from `offset`.
+    m_bufEnd = m_buf + kPLYReadBufferSize;
+    m_pos = m_bufEnd;
+    m_end = m_bufEnd;
+    refill_buffer();
+    return true;
+  }
+
+
+  bool PLYReader::skip_to(int64_t offset)
+  {
+    if (offset < m_bufOffset) {
+      // Already gone past it.
+      return false;
+    }
+
+    if (offset <= m_bufOffset + static_cast<int64_t>(m_bufEnd - m_buf)) {
+      // Still in the buffer.
+      m_pos = m_buf + (offset - m_bufOffset);
+      m_end = m_pos;
+      refill_buffer();
+      return true;
+    }
+
+    // Read up to `offset` and throw it away, using the read buffer as scratch space.
+    PLYPhaseTimer timer(m_stats, &PLYReaderStats::readNs);
+    int64_t remaining = offset - m_fileOffset;
+    while (remaining > 0) {
+      size_t chunk = static_cast<size_t>(remaining < kPLYReadBufferSize ? remaining : kPLYReadBufferSize);
+      size_t numRead = m_source->read(m_buf, chunk);
+      if (numRead == 0) {
+        return false;
+      }
+      remaining -= static_cast<int64_t>(numRead);
+      if (m_stats != nullptr) {
+        m_stats->bytesRead += numRead;
+      }
+    }
+    m_fileOffset = offset;
+    m_bufOffset = offset;
+    m_atEOF = false;
+
+    m_bufEnd = m_buf + kPLYReadBufferSize;
+    m_pos = m_bufEnd;
+    m_end = m_bufEnd;
+    refill_buffer();
+    return true;
+  }
+
+
   bool PLYReader::rewind_to_safe_char()
   {
     // If it looks like a token might run past the end of this buffer, move
@@ -1391,12 +1821,18 @@ namespace miniply {
         --safe;
       }
       if (safe < m_end) {
-        // No safe places to rewind to in the whole buffer!
-        return false;
+        // No safe places to rewind to in the whole buffer! In the header,
+        // this means the last header line runs into binary data, which isn't
+        // tokenized, so the buffer can be kept as it is.
+        if (m_inDataSection) {
+          return false;
+        }
+      }
+      else {
+        ++safe;
+        m_buf[kPLYReadBufferSize] = *safe;
+        m_bufEnd = safe;
       }
-      ++safe;
-      m_buf[kPLYReadBufferSize] = *safe;
-      m_bufEnd = safe;
     }
     m_buf[m_bufEnd - m_buf] = '\0';
 
@@ -1608,14 +2044,39 @@ namespace miniply {
 
   bool PLYReader::load_fixed_size_element(PLYElement& elem)
   {
-    size_t numBytes = static_cast<size_t>(elem.count) * elem.rowStride;
+    return load_fixed_size_rows(elem, elem.count);
+  }
+
+
+  bool PLYReader::load_fixed_size_rows(PLYElement& elem, uint32_t numRows)
+  {
+    size_t numBytes = static_cast<size_t>(numRows) * elem.rowStride;
 
+    // Little-endian data held in memory by the source is used where it is.
+    if (m_fileType == PLYFileType::Binary && m_source->data() != nullptr) {
+      int64_t start = m_bufOffset + static_cast<int64_t>(m_pos - m_buf);
+      if (start + static_cast<int64_t>(numBytes) > m_source->size() ||
+          !seek_to(start + static_cast<int64_t>(numBytes))) {
+        m_valid = false;
+        return false;
+      }
+      m_elementView = m_source->data() + start;
+      m_elementViewSize = numBytes;
+      m_loadedRows = numRows;
+      m_elementLoaded = true;
+      return true;
+    }
+
+    note_growth(m_elementData, numBytes);
     m_elementData.resize(numBytes);
+    if (m_stats != nullptr) {
+      m_stats->copiedBytes += numBytes;
+    }
 
     if (m_fileType == PLYFileType::ASCII) {
       size_t back = 0;
 
-      for (uint32_t row = 0; row < elem.count; row++) {
+      for (uint32_t row = 0; row < numRows; row++) {
         for (PLYProperty& prop : elem.properties) {
           if (!load_ascii_scalar_property(prop, back)) {
             m_valid = false;
@@ -1649,8 +2110,9 @@ namespace miniply {
       // We assume the CPU is little endian, so if the file is big-endian we
       // need to do an endianness swap on every data item in the block.
       if (m_fileType == PLYFileType::BinaryBigEndian) {
+        PLYPhaseTimer timer(m_stats, &PLYReaderStats::swapNs);
         uint8_t* data = m_elementData.data();
-        for (uint32_t row = 0; row < elem.count; row++) {
+        for (uint32_t row = 0; row < numRows; row++) {
           for (PLYProperty& prop : elem.properties) {
             size_t numBytes = kPLYPropertySize[uint32_t(prop.type)];
             switch (numBytes) {
@@ -1672,23 +2134,32 @@ namespace miniply {
       }
     }
 
+    m_elementView = m_elementData.data();
+    m_elementViewSize = m_elementData.size();
+    m_loadedRows = numRows;
     m_elementLoaded = true;
+    note_peak(held_bytes());
     return true;
   }
 
 
   bool PLYReader::load_variable_size_element(PLYElement& elem)
   {
+    note_growth(m_elementData, static_cast<size_t>(elem.count) * elem.rowStride);
     m_elementData.resize(static_cast<size_t>(elem.count) * elem.rowStride);
 
     // Preallocate enough space for each row in the property to contain three
     // items. This is based on the assumptions that (a) the most common use for
     // list properties is vertex indices; and (b) most faces are triangles.
     // This gives a performance boost because we won't have to grow the
-    // listData vector as many times during loading.
+    // listData vector as many times during loading. There is exactly one
+    // count per row, so the row counts never have to grow.
     for (PLYProperty& prop : elem.properties) {
       if (prop.countType != PLYPropertyType::None) {
+        note_growth(prop.listData, elem.count * kPLYPropertySize[uint32_t(prop.type)] * 3);
         prop.listData.reserve(elem.count * kPLYPropertySize[uint32_t(prop.type)] * 3);
+        note_growth(prop.rowCount, elem.count);
+        prop.rowCount.reserve(elem.count);
       }
     }
 
@@ -1733,11 +2204,33 @@ namespace miniply {
       }
     }
 
+    m_elementView = m_elementData.data();
+    m_elementViewSize = m_elementData.size();
+    m_loadedRows = elem.count;
     m_elementLoaded = true;
+    if (m_stats != nullptr) {
+      m_stats->copiedBytes += m_elementData.size();
+      for (const PLYProperty& prop : elem.properties) {
+        m_stats->copiedBytes += prop.listData.size();
+      }
+    }
+    note_peak(held_bytes());
     return true;
   }
 
 
+  size_t PLYReader::held_bytes() const
+  {
+    size_t bytes = (kPLYReadBufferSize + 1) + (kPLYTempBufferSize + 1) + m_elementData.capacity();
+    if (has_element()) {
+      for (const PLYProperty& prop : element()->properties) {
+        bytes += prop.listData.capacity() + prop.rowCount.capacity() * sizeof(uint32_t);
+      }
+    }
+    return bytes;
+  }
+
+
   bool PLYReader::load_ascii_scalar_property(PLYProperty& prop, size_t& destIndex)
   {
     uint8_t value[8];
@@ -1763,7 +2256,9 @@ namespace miniply {
     const size_t numBytes = kPLYPropertySize[uint32_t(prop.type)];
 
     size_t back = prop.listData.size();
+    note_growth(prop.rowCount, prop.rowCount.size() + 1);
     prop.rowCount.push_back(static_cast<uint32_t>(count));
+    note_growth(prop.listData, back + numBytes * size_t(count));
     prop.listData.resize(back + numBytes * size_t(count));
 
     for (uint32_t i = 0; i < uint32_t(count); i++) {
@@ -1824,7 +2319,9 @@ namespace miniply {
       }
     }
     size_t back = prop.listData.size();
+    note_growth(prop.rowCount, prop.rowCount.size() + 1);
     prop.rowCount.push_back(static_cast<uint32_t>(count));
+    note_growth(prop.listData, back + listBytes);
     prop.listData.resize(back + listBytes);
     std::memcpy(prop.listData.data() + back, m_pos, listBytes);
 
@@ -1880,7 +2377,9 @@ namespace miniply {
       }
     }
     size_t back = prop.listData.size();
+    note_growth(prop.rowCount, prop.rowCount.size() + 1);
     prop.rowCount.push_back(static_cast<uint32_t>(count));
+    note_growth(prop.listData, back + listBytes);
     prop.listData.resize(back + listBytes);
 
     uint8_t* list = prop.listData.data() + back;
@@ -28,6 +28,8 @@ SOFTWARE.
 #include <cstdarg>
 #include <cstdint>
 #include <cstdio>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -144,17 +146,173 @@ namespace miniply {
   };
 
 
+  //
+  // PLY data sources
+  //
+
+  /// Where a `PLYReader` gets its bytes from. Implement this to read PLY data
+  /// from anything other than a file or a block of memory.
+  class PLYSource {
+  public:
+    virtual ~PLYSource();
+
+    /// Copy up to `size` bytes from the current position into `dest` and move
+    /// past them. Returns the number of bytes copied, which is less than
+    /// `size` only at the end of the data or on error.
+    virtual size_t read(void* dest, size_t size) = 0;
+
+    /// Move to byte `offset` from the start of the data. Returns false if that
+    /// isn't possible.
+    virtual bool seek(int64_t offset) = 0;
+
+    /// Whether `seek` works. For sources that can only be read front to back
+    /// (pipes, sockets, decompressors) the reader gets past data it doesn't
+    /// need by reading and discarding it.
+    virtual bool seekable() const;
+
+    /// The whole of the data if the source holds it in memory, otherwise
+    /// nullptr. The reader uses binary data from such sources in place
+    /// wherever it can, rather than copying it.
+    virtual const uint8_t* data() const;
+
+    /// Size of the data in bytes, or -1 if it isn't known.
+    virtual int64_t size() const;
+  };
+
+
+  /// Reads from a file, which it closes when destroyed unless `closeWhenDone`
+  /// is false (e.g. for stdin). Pipes and other files that can't be
+  /// repositioned are read front to back.
+  class PLYFileSource : public PLYSource {
+  public:
+    explicit PLYFileSource(FILE* f, bool closeWhenDone = true);
+    ~PLYFileSource() override;
+
+    size_t read(void* dest, size_t size) override;
+    bool seek(int64_t offset) override;
+    bool seekable() const override;
+
+  private:
+    FILE* m_f            = nullptr;
+    bool m_closeWhenDone = true;
+    bool m_seekable      = false;
+    int64_t m_start      = 0;
+  };
+
+
+  /// Reads from a block of memory, which must stay valid for as long as the
+  /// source and anything extracted from it by reference are in use.
+  class PLYMemorySource : public PLYSource {
+  public:
+    PLYMemorySource(const void* data, size_t size);
+
+    size_t read(void* dest, size_t size) override;
+    bool seek(int64_t offset) override;
+    const uint8_t* data() const override;
+    int64_t size() const override;
+
+  private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size         = 0;
+    size_t m_pos          = 0;
+  };
+
+
+  /// Reads through user-supplied functions. `readFunc` may return fewer bytes
+  /// than asked for, and returns 0 at the end of the data. `seekFunc` may be
+  /// left empty for data that can only be read from front to back.
+  class PLYCallbackSource : public PLYSource {
+  public:
+    using ReadFunc = std::function<size_t(void* dest, size_t size)>;
+    using SeekFunc = std::function<bool(int64_t offset)>;
+
+    explicit PLYCallbackSource(ReadFunc readFunc, SeekFunc seekFunc = SeekFunc());
+
+    size_t read(void* dest, size_t size) override;
+    bool seek(int64_t offset) override;
+    bool seekable() const override;
+
+  private:
+    ReadFunc m_readFunc;
+    SeekFunc m_seekFunc;
+  };
+
+
+  /// Opens `filename` for reading, or standard input if it is "-". Returns
+  /// nullptr if the file can't be opened.
+  std::unique_ptr<PLYSource> open_file_source(const char* filename);
+
+
+  //
+  // PLYReader profiling
+  //
+
+  /// Time spent in, and work done by, a `PLYReader`. Times are in nanoseconds
+  /// and don't overlap: e.g. reading from the source while loading an element
+  /// counts towards `readNs`, not `loadNs`.
+  struct PLYReaderStats {
+    uint64_t headerNs     = 0; //!< Parsing the header.
+    uint64_t readNs       = 0; //!< Reading from the source, including any decompression.
+    uint64_t loadNs       = 0; //!< Loading fixed-size elements, parsing ASCII ones.
+    uint64_t swapNs       = 0; //!< Byte swapping fixed-size big-endian elements.
+    uint64_t listNs       = 0; //!< Loading variable-size elements, i.e. decoding lists.
+    uint64_t extractNs    = 0; //!< `extract_*` calls copying values as they are.
+    uint64_t convertNs    = 0; //!< `extract_*` calls converting values to another type.
+
+    uint64_t bytesRead    = 0; //!< Bytes read from the source.
+    uint64_t refills      = 0; //!< Reads into the read buffer.
+    uint64_t memmoves     = 0; //!< Moves of unconsumed bytes to the start of the read buffer.
+    uint64_t memmoveBytes = 0;
+    uint64_t conversions  = 0; //!< Values converted to another type by `extract_*`.
+
+    uint64_t peakBytes      = 0; //!< Most memory held at once by the buffers, element data and lists.
+    uint64_t allocations    = 0; //!< Times the element data, lists or list counts were (re)allocated.
+    uint64_t allocatedBytes = 0;
+    uint64_t copiedBytes    = 0; //!< Bytes copied into the element data and lists, and out by `extract_*`.
+
+    uint64_t total_ns() const {
+      return headerNs + readNs + loadNs + swapNs + listNs + extractNs + convertNs;
+    }
+  };
+
+
+  //
+  // PLYReader class
+  //
+
   class PLYReader {
   public:
+    /// Read the file `filename`, or standard input if it is "-".
     PLYReader(const char* filename);
+    /// Read from `source` instead of a file. A null `source` gives an invalid
+    /// reader. If `stats` is not null the reader adds its timings and counters
+    /// to it, from the header onwards; it must outlive the reader.
+    explicit PLYReader(std::unique_ptr<PLYSource> source, PLYReaderStats* stats = nullptr);
     ~PLYReader();
 
     bool valid() const;
+    /// Whether the data can be read out of order. If not, elements can still
+    /// be skipped, but only forwards.
+    bool seekable() const;
     bool has_element() const;
     const PLYElement* element() const;
     bool load_element();
     void next_element();
 
+    /// Load the next `maxRows` rows (or those left, if fewer) of the current
+    /// element, replacing the rows loaded before, so that only that many rows
+    /// are held at a time. The `extract_*` functions then work on those rows
+    /// only. Only fixed-size elements can be loaded this way, and it can't be
+    /// mixed with `load_element`. Returns false if no rows are left.
+    bool load_element_rows(uint32_t maxRows);
+    /// Number of rows currently loaded, and index of the first of them.
+    uint32_t loaded_rows() const;
+    uint32_t first_loaded_row() const;
+
+    /// Whether fixed-size elements are used where the source holds them,
+    /// without being copied into the reader (little-endian data in memory).
+    bool loads_in_place() const;
+
     PLYFileType file_type() const;
     int version_major() const;
     int version_minor() const;
@@ -162,6 +320,18 @@ namespace miniply {
     uint32_t find_element(const char* name) const;
     PLYElement* get_element(uint32_t idx);
 
+    /// Byte offset from the start of the file to the first row of element
+    /// `idx`, or -1 if it can't be worked out from the header alone. This is
+    /// only possible for binary files where every element before `idx` is
+    /// fixed-size.
+    int64_t element_offset(uint32_t idx) const;
+
+    /// Move the reader to the start of element `idx`, which begins at byte
+    /// `offset` in the file (see `element_offset`). Any elements in between
+    /// are skipped without being read. Several readers opened on the same
+    /// file can use this to load different elements independently.
+    bool seek_element(uint32_t idx, int64_t offset);
+
     /// Check whether the current element has the given name.
     bool element_is(const char* name) const;
 
@@ -237,6 +407,8 @@ namespace miniply {
 
   private:
     bool refill_buffer();
+    bool seek_to(int64_t offset);
+    bool skip_to(int64_t offset);
     bool rewind_to_safe_char();
     bool accept();
     bool advance();
@@ -261,6 +433,7 @@ namespace miniply {
     bool parse_property(std::vector<PLYProperty>& properties);
 
     bool load_fixed_size_element(PLYElement& elem);
+    bool load_fixed_size_rows(PLYElement& elem, uint32_t numRows);
     bool load_variable_size_element(PLYElement& elem);
 
     bool load_ascii_scalar_property(PLYProperty& prop, size_t& destIndex);
@@ -272,15 +445,37 @@ namespace miniply {
 
     bool ascii_value(PLYPropertyType propType, uint8_t value[8]);
 
+    /// Bytes currently held by the buffers, element data and lists.
+    size_t held_bytes() const;
+    /// Counts the allocation growing `v` to `newSize` elements makes, if any.
+    template <class T>
+    void note_growth(const std::vector<T>& v, size_t newSize) {
+      if (m_stats != nullptr && newSize > v.capacity()) {
+        size_t newBytes = (newSize > 2 * v.size() ? newSize : 2 * v.size()) * sizeof(T);
+        m_stats->allocations++;
+        m_stats->allocatedBytes += newBytes;
+        // The old and the new storage are both held while the data is moved over.
+        note_peak(held_bytes() + newBytes);
+      }
+    }
+    void note_peak(size_t bytes) {
+      if (m_stats != nullptr && bytes > m_stats->peakBytes) {
+        m_stats->peakBytes = bytes;
+      }
+    }
+
   private:
-    FILE* m_f             = nullptr;
+    std::unique_ptr<PLYSource> m_source;
+    PLYReaderStats* m_stats = nullptr;
     char* m_buf           = nullptr;
     const char* m_bufEnd  = nullptr;
     const char* m_pos     = nullptr;
     const char* m_end     = nullptr;
     bool m_inDataSection  = false;
     bool m_atEOF          = false;
-    int64_t m_bufOffset   = 0;
+    int64_t m_bufOffset   = 0;    //!< File offset of the first byte in `m_buf`.
+    int64_t m_fileOffset  = 0;    //!< File offset of the next byte `refill_buffer` will read.
+    int64_t m_dataOffset  = -1;   //!< File offset of the first byte after the header, for binary files.
 
     bool m_valid          = false;
 
@@ -292,6 +487,10 @@ namespace miniply {
     size_t m_currentElement = 0;
     bool m_elementLoaded    = false;
     std::vector<uint8_t> m_elementData;
+    const uint8_t* m_elementView = nullptr; //!< Data of the current element: either `m_elementData` or a range in the source's memory.
+    size_t m_elementViewSize     = 0;
+    uint32_t m_firstLoadedRow    = 0;
+    uint32_t m_loadedRows        = 0;
 
     char* m_tmpBuf = nullptr;
   };
@@ -0,0 +1,155 @@
+#ifndef PLYTORCH_PARALLEL_H
+#define PLYTORCH_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// A thread pool for `parallel_for` to run on instead of starting threads of
+// its own. `num_threads` is the number of threads it has, as seen from the
+// calling thread; `run` calls `run_chunk(chunk)` for every chunk in
+// [0, num_chunks), spreading them over the pool, and returns once all are
+// done. The torch bridge sets ATen's intra-op pool, so that plytorch shares
+// PyTorch's threads and follows torch.set_num_threads.
+struct ParallelBackend {
+    std::function<int64_t()> num_threads;
+    std::function<void(int64_t num_chunks, const std::function<void(int64_t chunk)>& run_chunk)> run;
+};
+
+inline ParallelBackend g_parallel_backend;
+
+// To be called before any `parallel_for`, e.g. when the module is loaded.
+inline void set_parallel_backend(ParallelBackend backend) {
+    g_parallel_backend = std::move(backend);
+}
+
+// Thread count set with `set_num_worker_threads`, 0 for the default.
+inline std::atomic<int64_t> g_num_worker_threads{0};
+
+// Number of threads `parallel_for` splits work between: as set with
+// `set_num_worker_threads`, else as many as the backend has, else one per
+// hardware thread.
+inline int64_t num_worker_threads() {
+    int64_t requested = g_num_worker_threads.load(std::memory_order_relaxed);
+    if (requested > 0) {
+        return requested;
+    }
+    if (g_parallel_backend.num_threads) {
+        return std::max<int64_t>(1, g_parallel_backend.num_threads());
+    }
+    unsigned int n = std::thread::hardware_concurrency();
+    return n > 0 ? int64_t(n) : 1;
+}
+
+// Caps `parallel_for` at `n` threads; 0 goes back to the default.
+inline void set_num_worker_threads(int64_t n) {
+    g_num_worker_threads.store(n > 0 ? n : 0, std::memory_order_relaxed);
+}
+
+// Cap on the threads of the `parallel_for` calls made by this thread, 0 for
+// none. Set for the duration of a read with `ScopedWorkerThreadLimit`.
+inline thread_local int64_t t_worker_thread_limit = 0;
+
+class ScopedWorkerThreadLimit {
+public:
+    explicit ScopedWorkerThreadLimit(int64_t n) : m_previous(t_worker_thread_limit) {
+        t_worker_thread_limit = n > 0 ? n : 0;
+    }
+    ~ScopedWorkerThreadLimit() {
+        t_worker_thread_limit = m_previous;
+    }
+
+    ScopedWorkerThreadLimit(const ScopedWorkerThreadLimit&) = delete;
+    ScopedWorkerThreadLimit& operator=(const ScopedWorkerThreadLimit&) = delete;
+
+private:
+    int64_t m_previous;
+};
+
+// Number of threads a `parallel_for` called on this thread splits work between.
+inline int64_t worker_threads_here() {
+    int64_t n = num_worker_threads();
+    return t_worker_thread_limit > 0 ? std::min(n, t_worker_thread_limit) : n;
+}
+
+// Runs the chunk [chunk_begin, chunk_end) of a `parallel_for` by calling `run()`.
+using ParallelChunkRunner = std::function<void(int64_t chunk_begin, int64_t chunk_end, const std::function<void()>& run)>;
+
+// Called on the thread starting a `parallel_for` that is split between
+// threads. Returns how to run its chunks, or an empty function to run them
+// directly. The torch bridge sets one so that the worker threads carry the
+// profiler state of the caller and show up in its traces.
+inline std::function<ParallelChunkRunner()> g_make_parallel_chunk_runner;
+
+inline void set_parallel_chunk_runner_factory(std::function<ParallelChunkRunner()> factory) {
+    g_make_parallel_chunk_runner = std::move(factory);
+}
+
+// Calls `f(chunk_begin, chunk_end)` for consecutive chunks covering
+// [begin, end), each at least `grain_size` long, on up to
+// `worker_threads_here()` threads: those of the backend if there is one,
+// otherwise threads started for the call, the calling thread processing the
+// first chunk. The first exception thrown by any chunk is rethrown after all
+// of them have finished.
+template <class F>
+void parallel_for(int64_t begin, int64_t end, int64_t grain_size, const F& f) {
+    if (begin >= end) {
+        return;
+    }
+    int64_t range = end - begin;
+    int64_t num_chunks = std::min(worker_threads_here(), (range + grain_size - 1) / std::max<int64_t>(grain_size, 1));
+    if (num_chunks <= 1) {
+        f(begin, end);
+        return;
+    }
+
+    int64_t chunk_size = (range + num_chunks - 1) / num_chunks;
+    ParallelChunkRunner runner = g_make_parallel_chunk_runner ? g_make_parallel_chunk_runner() : ParallelChunkRunner();
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto run_chunk = [&](int64_t chunk) {
+        int64_t chunk_begin = begin + chunk * chunk_size;
+        int64_t chunk_end = std::min(end, chunk_begin + chunk_size);
+        try {
+            if (runner) {
+                runner(chunk_begin, chunk_end, [&]() { f(chunk_begin, chunk_end); });
+            } else {
+                f(chunk_begin, chunk_end);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+
+    if (g_parallel_backend.run) {
+        g_parallel_backend.run(num_chunks, run_chunk);
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(num_chunks - 1);
+    for (int64_t chunk = 1; chunk < num_chunks; ++chunk) {
+        workers.emplace_back(run_chunk, chunk);
+    }
+    run_chunk(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif // PLYTORCH_PARALLEL_H
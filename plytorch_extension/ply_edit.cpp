@@ -0,0 +1,348 @@
+#include "ply_edit.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "gzip_io.h"
+#include "miniply.h"
+
+
+namespace {
+
+// Rows appended to a file are interleaved into a buffer of about this size
+// before being written.
+constexpr int64_t kAppendChunkBytes = 16 << 20;
+
+// Most bytes of a file read looking for the end of its header.
+constexpr size_t kMaxHeaderBytes = 1 << 20;
+
+struct PropertyType {
+    const char* name;
+    miniply::PLYPropertyType type;
+    uint32_t size;
+};
+
+// Types as PLYWriteProperty names them.
+const PropertyType kPropertyTypes[] = {
+    {"char", miniply::PLYPropertyType::Char, 1},
+    {"uchar", miniply::PLYPropertyType::UChar, 1},
+    {"short", miniply::PLYPropertyType::Short, 2},
+    {"ushort", miniply::PLYPropertyType::UShort, 2},
+    {"int", miniply::PLYPropertyType::Int, 4},
+    {"uint", miniply::PLYPropertyType::UInt, 4},
+    {"float", miniply::PLYPropertyType::Float, 4},
+    {"double", miniply::PLYPropertyType::Double, 8},
+};
+
+const PropertyType* find_property_type(miniply::PLYPropertyType type) {
+    for (const PropertyType& entry : kPropertyTypes) {
+        if (entry.type == type) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const char* property_type_name(miniply::PLYPropertyType type) {
+    const PropertyType* entry = find_property_type(type);
+    return entry != nullptr ? entry->name : "unknown";
+}
+
+// Opens the file at `path` and parses its header, which must be followed by
+// data that can be edited in place.
+void open_editable(const std::string& path, miniply::PLYReader& reader) {
+    if (!reader.valid()) {
+        throw std::runtime_error("Failed to open specified path: " + path);
+    }
+    if (!reader.seekable()) {
+        throw std::runtime_error("cannot edit " + path + " in place: it is compressed or not a regular file");
+    }
+}
+
+// Where the row count of the last element is in the header of the file at
+// `path`: its first character and the characters it may take, up to the end
+// of its line.
+struct CountField {
+    int64_t offset = 0;
+    size_t width = 0;
+};
+
+CountField find_last_count(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::string header;
+    size_t end = std::string::npos;
+    char chunk[4096];
+    while (end == std::string::npos && header.size() < kMaxHeaderBytes && file) {
+        file.read(chunk, sizeof(chunk));
+        header.append(chunk, size_t(file.gcount()));
+        end = header.find("end_header");
+    }
+    if (end == std::string::npos) {
+        throw std::runtime_error("no end of header in " + path);
+    }
+    header.resize(end);
+
+    // "element <name> <count>", the count maybe followed by spaces.
+    size_t line = header.rfind("\nelement ");
+    size_t name = header.find_first_not_of(" \t", line + 9);
+    size_t count = header.find_first_of(" \t", name);
+    count = header.find_first_not_of(" \t", count);
+    size_t line_end = header.find_first_of("\r\n", count);
+    if (line == std::string::npos || count == std::string::npos || line_end == std::string::npos) {
+        throw std::runtime_error("cannot find the row count of the last element in the header of " + path);
+    }
+    size_t digits_end = header.find_first_not_of("0123456789", count);
+    if (digits_end == count || header.find_first_not_of(' ', digits_end) != line_end) {
+        throw std::runtime_error("cannot find the row count of the last element in the header of " + path);
+    }
+    return CountField{int64_t(count), line_end - count};
+}
+
+#ifndef _WIN32
+void write_at(int fd, const char* data, size_t size, int64_t offset, const std::string& path) {
+    while (size > 0) {
+        ssize_t written = ::pwrite(fd, data, size, off_t(offset));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            throw std::runtime_error("Failed to write to " + path + " (" + std::strerror(errno) + ")");
+        }
+        data += written;
+        size -= size_t(written);
+        offset += written;
+    }
+}
+#endif
+
+// `element` with its properties in the order of `file_element`, checked
+// against their declarations in the file.
+PLYWriteElement in_file_order(const miniply::PLYElement& file_element, const PLYWriteElement& element) {
+    if (element.properties.size() != file_element.properties.size()) {
+        throw std::runtime_error("element '" + element.name + "' has " +
+                                 std::to_string(file_element.properties.size()) + " properties, got " +
+                                 std::to_string(element.properties.size()));
+    }
+    PLYWriteElement result{element.name, element.count, {}};
+    for (const miniply::PLYProperty& file_property : file_element.properties) {
+        auto property = std::find_if(element.properties.begin(), element.properties.end(),
+                                     [&](const PLYWriteProperty& p) { return p.name == file_property.name; });
+        if (property == element.properties.end()) {
+            throw std::runtime_error("missing property '" + file_property.name + "' of element '" + element.name +
+                                     "'");
+        }
+        if (property->type != property_type_name(file_property.type)) {
+            throw std::runtime_error("property '" + property->name + "' is of type " +
+                                     property_type_name(file_property.type) + ", got values of type " +
+                                     property->type);
+        }
+        bool file_list = file_property.countType != miniply::PLYPropertyType::None;
+        if (file_list != property->is_list) {
+            throw std::runtime_error("property '" + property->name + "' is " + (file_list ? "" : "not ") +
+                                     "a list in the file");
+        }
+        result.properties.push_back(*property);
+        if (file_list) {
+            const PropertyType* count_type = find_property_type(file_property.countType);
+            result.properties.back().count_size = count_type != nullptr ? count_type->size : 0;
+            if (property->count_size > result.properties.back().count_size) {
+                throw std::runtime_error("list property '" + property->name + "' has rows longer than its " +
+                                         property_type_name(file_property.countType) + " lengths can hold");
+            }
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+
+void update_ply_property(const std::string& path, const std::string& element_name, const PLYWriteProperty& property,
+                         int64_t count) {
+    // Only the header is read.
+    miniply::PLYReader reader(open_decompressed(miniply::open_file_source(path.c_str())));
+    open_editable(path, reader);
+    if (reader.file_type() == miniply::PLYFileType::ASCII) {
+        throw std::runtime_error("cannot update " + path + " in place: only binary files have values at fixed places");
+    }
+
+    uint32_t element_idx = reader.find_element(element_name.c_str());
+    if (element_idx == miniply::kInvalidIndex) {
+        throw std::runtime_error("no element '" + element_name + "' in " + path);
+    }
+    const miniply::PLYElement* element = reader.get_element(element_idx);
+    uint32_t property_idx = element->find_property(property.name.c_str());
+    if (property_idx == miniply::kInvalidIndex) {
+        throw std::runtime_error("no property '" + property.name + "' in element '" + element_name + "' of " + path);
+    }
+    const miniply::PLYProperty& file_property = element->properties[property_idx];
+    if (file_property.countType != miniply::PLYPropertyType::None || property.is_list) {
+        throw std::runtime_error("cannot update list property '" + property.name + "' in place");
+    }
+    if (property.type != property_type_name(file_property.type)) {
+        throw std::runtime_error("property '" + property.name + "' of " + path + " is of type " +
+                                 property_type_name(file_property.type) + ", got values of type " + property.type);
+    }
+    if (count != int64_t(element->count)) {
+        throw std::runtime_error("element '" + element_name + "' of " + path + " has " +
+                                 std::to_string(element->count) + " rows, got " + std::to_string(count));
+    }
+    if (!element->fixedSize) {
+        throw std::runtime_error("cannot update element '" + element_name + "' in place: its rows vary in size");
+    }
+    int64_t element_offset = reader.element_offset(element_idx);
+    if (element_offset < 0) {
+        throw std::runtime_error("cannot update element '" + element_name +
+                                 "' in place: elements with lists come before it");
+    }
+    if (count == 0) {
+        return;
+    }
+
+#ifdef _WIN32
+    throw std::runtime_error("updating files in place is not supported on this platform");
+#else
+    const int64_t row_stride = int64_t(element->rowStride);
+    const int64_t element_size = row_stride * count;
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + path + " for writing (" + std::strerror(errno) + ")");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || int64_t(st.st_size) < element_offset + element_size) {
+        ::close(fd);
+        throw std::runtime_error("file is truncated: " + path);
+    }
+
+    // Only the rows of the element are mapped, from the page they start in.
+    const int64_t page_size = int64_t(::sysconf(_SC_PAGESIZE));
+    const int64_t map_offset = element_offset - element_offset % page_size;
+    const size_t map_size = size_t(element_offset - map_offset + element_size);
+    void* addr = ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, off_t(map_offset));
+    int error = errno;
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error("Could not map " + path + " for writing (" + std::strerror(error) + ")");
+    }
+
+    PLYByteOrder byte_order = reader.file_type() == miniply::PLYFileType::BinaryBigEndian
+                                  ? PLYByteOrder::BigEndian
+                                  : PLYByteOrder::LittleEndian;
+    char* rows = static_cast<char*>(addr) + (element_offset - map_offset);
+    try {
+        write_ply_column(property, 0, count, rows + file_property.offset, row_stride, byte_order);
+    } catch (...) {
+        ::munmap(addr, map_size);
+        throw;
+    }
+    ::munmap(addr, map_size);
+#endif
+}
+
+int64_t append_ply_rows(const std::string& path, const PLYWriteElement& element) {
+    miniply::PLYReader reader(open_decompressed(miniply::open_file_source(path.c_str())));
+    open_editable(path, reader);
+    uint32_t last_idx = reader.num_elements() - 1;
+    const miniply::PLYElement* file_element = reader.num_elements() > 0 ? reader.get_element(last_idx) : nullptr;
+    if (file_element == nullptr || file_element->name != element.name) {
+        throw std::runtime_error("cannot append to element '" + element.name + "' of " + path +
+                                 ": only the last element of a file can grow");
+    }
+    PLYWriteElement rows = in_file_order(*file_element, element);
+
+    int64_t count = int64_t(file_element->count) + rows.count;
+    // miniply reads row counts as `int`.
+    if (count > int64_t(INT32_MAX)) {
+        throw std::runtime_error("cannot append " + std::to_string(rows.count) + " rows to element '" + element.name +
+                                 "' of " + path + ": PLY elements can have at most " + std::to_string(INT32_MAX) +
+                                 " rows");
+    }
+    CountField count_field = find_last_count(path);
+    std::string count_text = std::to_string(count);
+    if (count_text.size() > count_field.width) {
+        throw std::runtime_error("no room in the header of " + path + " for " + std::to_string(count) +
+                                 " rows of '" + element.name + "': save it with appendable=True");
+    }
+    count_text.resize(count_field.width, ' ');
+    if (rows.count == 0) {
+        return count;
+    }
+
+#ifdef _WIN32
+    throw std::runtime_error("appending to files in place is not supported on this platform");
+#else
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + path + " for writing (" + std::strerror(errno) + ")");
+    }
+    try {
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            throw std::runtime_error("Could not stat " + path + " (" + std::strerror(errno) + ")");
+        }
+        // Rows go right after those the header counts. Where that is follows
+        // from the header when every row has a fixed size, and anything past
+        // it (e.g. left by an append that failed before the count was
+        // updated) is overwritten; otherwise rows go at the end of the file.
+        int64_t offset = int64_t(st.st_size);
+        int64_t element_offset = reader.element_offset(last_idx);
+        bool exact = element_offset >= 0 && file_element->fixedSize;
+        if (exact) {
+            offset = element_offset + int64_t(file_element->rowStride) * file_element->count;
+            if (offset > int64_t(st.st_size)) {
+                throw std::runtime_error("file is truncated: " + path);
+            }
+        }
+
+        PLYWriteFormat format = reader.file_type() == miniply::PLYFileType::ASCII ? PLYWriteFormat::ASCII
+                                                                                   : PLYWriteFormat::Binary;
+        PLYByteOrder byte_order = reader.file_type() == miniply::PLYFileType::BinaryBigEndian
+                                      ? PLYByteOrder::BigEndian
+                                      : PLYByteOrder::LittleEndian;
+        std::string text;
+        std::vector<char> chunk;
+        if (format == PLYWriteFormat::ASCII && offset > 0) {
+            char last = '\n';
+            if (::pread(fd, &last, 1, off_t(offset - 1)) == 1 && last != '\n') {
+                text = "\n";
+            }
+        }
+        for (int64_t row = 0, row_end; row < rows.count; row = row_end) {
+            row_end = ply_chunk_end(rows, row, kAppendChunkBytes, format);
+            if (format == PLYWriteFormat::ASCII) {
+                format_ply_rows(rows, row, row_end, 0, text);
+                write_at(fd, text.data(), text.size(), offset, path);
+                offset += int64_t(text.size());
+                text.clear();
+            } else {
+                chunk.resize(size_t(ply_rows_size(rows, row, row_end)));
+                write_ply_rows(rows, row, row_end, chunk.data(), byte_order);
+                write_at(fd, chunk.data(), chunk.size(), offset, path);
+                offset += int64_t(chunk.size());
+            }
+        }
+        if (exact && ::ftruncate(fd, off_t(offset)) != 0) {
+            throw std::runtime_error("Could not resize " + path + " (" + std::strerror(errno) + ")");
+        }
+        // The rows are counted only once they are all written.
+        write_at(fd, count_text.data(), count_text.size(), count_field.offset, path);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    return count;
+#endif
+}
@@ -0,0 +1,36 @@
+#ifndef PLYTORCH_PLY_EDIT_H
+#define PLYTORCH_PLY_EDIT_H
+
+#include <string>
+
+#include "ply_writer.h"
+
+
+// Overwrites property `property.name` of element `element_name` in the binary
+// PLY file at `path` with the values of `property`, one per row, in place:
+// only the bytes of that property are rewritten, through a writable mapping
+// of the element's rows, and the rest of the file is left as it is.
+//
+// The property must be a scalar of the type declared in the file, and
+// `count` the number of rows of the element. The element and every element
+// before it must be fixed-size, so that where its rows are follows from the
+// header. Throws std::runtime_error otherwise, or if the file can't be mapped
+// for writing (e.g. compressed or not a regular file).
+void update_ply_property(const std::string& path, const std::string& element_name, const PLYWriteProperty& property,
+                         int64_t count);
+
+// Appends the rows of `element` to the element of the same name of the PLY
+// file at `path`, which must be its last element, and returns its new row
+// count. Only the new rows are written, at the end of the element's data,
+// then the row count in the header is rewritten in place, so the cost
+// doesn't depend on the size of the file.
+//
+// `element` must have the properties of the file's element, in any order,
+// with the types declared in the file; list lengths are written as the file
+// declares them. The new count must fit in the characters of the old one in
+// the header, which headers written with `appendable` leave room for. Throws
+// std::runtime_error otherwise, or if the file is compressed or not a regular
+// file.
+int64_t append_ply_rows(const std::string& path, const PLYWriteElement& element);
+
+#endif // PLYTORCH_PLY_EDIT_H
@@ -0,0 +1,253 @@
+#include "ply_follow.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+
+namespace {
+
+// Most bytes of a file read looking for the end of its header.
+constexpr size_t kMaxHeaderBytes = 1 << 20;
+
+const uint32_t kPropertySize[] = {1, 1, 2, 2, 4, 4, 4, 8};
+
+bool is_big_endian() {
+    const uint32_t one = 1;
+    char first_byte;
+    std::memcpy(&first_byte, &one, 1);
+    return first_byte == 0;
+}
+
+uint32_t property_size(miniply::PLYPropertyType type) {
+    return kPropertySize[uint32_t(type)];
+}
+
+bool same_layout(const miniply::PLYElement& a, const miniply::PLYElement& b) {
+    if (a.name != b.name || a.rowStride != b.rowStride || a.properties.size() != b.properties.size()) {
+        return false;
+    }
+    for (size_t i = 0; i != a.properties.size(); ++i) {
+        if (a.properties[i].name != b.properties[i].name || a.properties[i].type != b.properties[i].type) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Where the header at the start of `text` ends: past the newline of the
+// "end_header" line, which may come after other whitespace (e.g. "\r\n"), as
+// miniply allows. Lines are looked for from `from` on, which must be the start
+// of one. Returns npos if `text` doesn't reach that far yet.
+size_t header_end(const std::string& text, size_t from) {
+    for (size_t pos = text.find("end_header", from); pos != std::string::npos;
+         pos = text.find("end_header", pos + 1)) {
+        if (pos != 0 && text[pos - 1] != '\n') {
+            continue;
+        }
+        size_t end = pos + 10;
+        while (end < text.size() && (text[end] == ' ' || text[end] == '\t' || text[end] == '\r')) {
+            ++end;
+        }
+        if (end < text.size() && text[end] == '\n') {
+            return end + 1;
+        }
+    }
+    return std::string::npos;
+}
+
+template <size_t Size>
+void copy_column(const char* src, int64_t rows, int64_t stride, bool swap, char* dest) {
+    for (int64_t row = 0; row != rows; ++row) {
+        if (swap) {
+            std::reverse_copy(src, src + Size, dest);
+        } else {
+            std::memcpy(dest, src, Size);
+        }
+        src += stride;
+        dest += Size;
+    }
+}
+
+} // namespace
+
+
+PLYFollower::PLYFollower(const std::string& path) : m_path(path) {
+#ifdef _WIN32
+    throw std::runtime_error("following files is not supported on this platform");
+#else
+    m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        throw std::runtime_error("Failed to open specified path: " + path);
+    }
+#ifdef __linux__
+    m_inotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify >= 0 && ::inotify_add_watch(m_inotify, path.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB) < 0) {
+        ::close(m_inotify);
+        m_inotify = -1;
+    }
+#endif
+#endif
+}
+
+PLYFollower::~PLYFollower() {
+#ifndef _WIN32
+    if (m_inotify >= 0) {
+        ::close(m_inotify);
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+#endif
+}
+
+bool PLYFollower::wait(int64_t timeout_ms) {
+#ifdef __linux__
+    if (m_inotify >= 0) {
+        struct pollfd fds = {m_inotify, POLLIN, 0};
+        int ready = ::poll(&fds, 1, int(std::min<int64_t>(std::max<int64_t>(timeout_ms, 0), 1 << 30)));
+        if (ready <= 0) {
+            return false;
+        }
+        // The events only say that something changed, which is read anew.
+        char events[4096];
+        while (::read(m_inotify, events, sizeof(events)) > 0) {
+        }
+        return true;
+    }
+#endif
+    std::this_thread::sleep_for(std::chrono::milliseconds(std::max<int64_t>(timeout_ms, 0)));
+    return false;
+}
+
+bool PLYFollower::read_header() {
+#ifndef _WIN32
+    std::string text;
+    size_t end = std::string::npos;
+    char chunk[4096];
+    while (end == std::string::npos && text.size() < kMaxHeaderBytes) {
+        ssize_t n = ::pread(m_fd, chunk, sizeof(chunk), off_t(text.size()));
+        if (n <= 0) {
+            break;
+        }
+        // The end of the last line may have come in with this chunk.
+        size_t from = text.rfind('\n');
+        from = (from == std::string::npos) ? 0 : from + 1;
+        text.append(chunk, size_t(n));
+        end = header_end(text, from);
+    }
+    if (end == std::string::npos) {
+        if (text.size() >= kMaxHeaderBytes) {
+            throw std::runtime_error("no end of header in the first " + std::to_string(kMaxHeaderBytes) +
+                                     " bytes of " + m_path);
+        }
+        // Still being written.
+        return false;
+    }
+    text.resize(end);
+    if (m_hasHeader && text == m_header) {
+        return true;
+    }
+
+    miniply::PLYReader reader(std::make_unique<miniply::PLYMemorySource>(text.data(), text.size()));
+    if (!reader.valid() || reader.num_elements() == 0) {
+        throw std::runtime_error("invalid PLY header in " + m_path);
+    }
+    if (reader.file_type() == miniply::PLYFileType::ASCII) {
+        throw std::runtime_error("cannot follow " + m_path + ": ASCII rows have no fixed size");
+    }
+    uint32_t last = reader.num_elements() - 1;
+    const miniply::PLYElement& element = *reader.get_element(last);
+    int64_t data_offset = reader.element_offset(last);
+    if (data_offset < 0 || !element.fixedSize || element.rowStride == 0) {
+        throw std::runtime_error("cannot follow element '" + element.name + "' of " + m_path +
+                                 ": its rows, or those of an element before it, vary in size");
+    }
+    if (m_hasHeader && !same_layout(m_element, element)) {
+        throw std::runtime_error("the properties of element '" + m_element.name + "' of " + m_path + " changed");
+    }
+    m_element = element;
+    m_dataOffset = data_offset;
+    m_swap = (reader.file_type() == miniply::PLYFileType::BinaryBigEndian) != is_big_endian();
+    m_header = std::move(text);
+    m_hasHeader = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+int64_t PLYFollower::read(int64_t max_rows, std::vector<char>& rows) {
+#ifdef _WIN32
+    return 0;
+#else
+    if (!read_header()) {
+        return 0;
+    }
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0) {
+        throw std::runtime_error("Could not stat " + m_path + " (" + std::strerror(errno) + ")");
+    }
+    const int64_t row_stride = int64_t(m_element.rowStride);
+    // A row still being written is left for the next read.
+    int64_t complete = std::max<int64_t>(0, (int64_t(st.st_size) - m_dataOffset) / row_stride);
+    if (complete < m_rowsRead) {
+        throw std::runtime_error(m_path + " shrank to " + std::to_string(complete) + " rows of '" + m_element.name +
+                                 "', after " + std::to_string(m_rowsRead) + " were read");
+    }
+    int64_t num_rows = complete - m_rowsRead;
+    if (max_rows >= 0) {
+        num_rows = std::min(num_rows, max_rows);
+    }
+    rows.resize(size_t(num_rows * row_stride));
+    size_t done = 0;
+    int64_t offset = m_dataOffset + m_rowsRead * row_stride;
+    while (done < rows.size()) {
+        ssize_t n = ::pread(m_fd, rows.data() + done, rows.size() - done, off_t(offset + int64_t(done)));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("Failed to read " + m_path + (n < 0 ? " (" + std::string(std::strerror(errno)) + ")"
+                                                                         : std::string(" (truncated)")));
+        }
+        done += size_t(n);
+    }
+    m_rowsRead += num_rows;
+    return num_rows;
+#endif
+}
+
+void PLYFollower::extract(const std::vector<char>& rows, int64_t num_rows, uint32_t property, void* dest) const {
+    const miniply::PLYProperty& prop = m_element.properties.at(property);
+    const char* src = rows.data() + prop.offset;
+    const int64_t stride = int64_t(m_element.rowStride);
+    char* out = static_cast<char*>(dest);
+    switch (property_size(prop.type)) {
+    case 1:
+        copy_column<1>(src, num_rows, stride, false, out);
+        break;
+    case 2:
+        copy_column<2>(src, num_rows, stride, m_swap, out);
+        break;
+    case 4:
+        copy_column<4>(src, num_rows, stride, m_swap, out);
+        break;
+    default:
+        copy_column<8>(src, num_rows, stride, m_swap, out);
+        break;
+    }
+}
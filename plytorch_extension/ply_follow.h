@@ -0,0 +1,71 @@
+#ifndef PLYTORCH_PLY_FOLLOW_H
+#define PLYTORCH_PLY_FOLLOW_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "miniply.h"
+
+
+// Follows a binary PLY file that is still being written, like `tail -f`:
+// returns the rows of its last element as they land in the file. Only whole
+// rows are returned, a row still being written is left for later, and the
+// header is read again every time, so that updates of the row count in it
+// (e.g. by `append_ply_rows`) are picked up. The last element must be
+// fixed-size, and so must every element before it, so that where its rows
+// are follows from the header.
+class PLYFollower {
+public:
+    // Opens the file, which must exist. Its header may not be complete yet.
+    // Throws std::runtime_error if it can't be opened.
+    explicit PLYFollower(const std::string& path);
+    ~PLYFollower();
+
+    PLYFollower(const PLYFollower&) = delete;
+    PLYFollower& operator=(const PLYFollower&) = delete;
+
+    // Waits up to `timeout_ms` for the file to change: through inotify on
+    // Linux, by sleeping elsewhere or where it can't be watched. Returns
+    // whether it was told of a change; changes may go unnoticed (e.g. on
+    // network filesystems), so the file is worth reading again either way.
+    bool wait(int64_t timeout_ms);
+
+    // Reads the header again and copies up to `max_rows` (all if negative)
+    // whole rows not returned before into `rows`, as they are laid out in the
+    // file. Returns their number, 0 if there are none yet, including while
+    // the header is incomplete. Throws std::runtime_error if the file isn't
+    // one that can be followed, if the layout of its last element changes, or
+    // if it shrinks.
+    int64_t read(int64_t max_rows, std::vector<char>& rows);
+
+    // Whether the header has been read, and the element followed once it has.
+    bool has_header() const { return m_hasHeader; }
+    const miniply::PLYElement& element() const { return m_element; }
+
+    // Copies the values of property `property` of the first `num_rows` of
+    // `rows` (as filled by `read`) to `dest`, back to back, in the byte order
+    // of this machine.
+    void extract(const std::vector<char>& rows, int64_t num_rows, uint32_t property, void* dest) const;
+
+    // Rows returned so far.
+    int64_t rows_read() const { return m_rowsRead; }
+    // Row count the header declares for the element, as of the last `read`,
+    // or -1 before the header has been read.
+    int64_t header_count() const { return m_hasHeader ? int64_t(m_element.count) : -1; }
+
+private:
+    bool read_header();
+
+    std::string m_path;
+    int m_fd = -1;
+    int m_inotify = -1;
+    std::string m_header;
+    bool m_hasHeader = false;
+    bool m_swap = false;  // Whether values are in the other byte order than this machine's.
+    miniply::PLYElement m_element;
+    int64_t m_dataOffset = 0;
+    int64_t m_rowsRead = 0;
+};
+
+#endif // PLYTORCH_PLY_FOLLOW_H
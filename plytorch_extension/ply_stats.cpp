@@ -0,0 +1,75 @@
+#include "ply_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+
+namespace {
+
+std::atomic<bool> g_profiling{false};
+
+std::mutex g_global_stats_mutex;
+PLYStats g_global_stats;
+
+} // namespace
+
+
+void PLYStats::add(const PLYStats& other) {
+#define PLYTORCH_STATS_ADD(name) name += other.name;
+    PLYTORCH_STATS_FIELDS(PLYTORCH_STATS_ADD)
+#undef PLYTORCH_STATS_ADD
+#define PLYTORCH_STATS_MAX(name) name = std::max(name, other.name);
+    PLYTORCH_STATS_PEAK_FIELDS(PLYTORCH_STATS_MAX)
+#undef PLYTORCH_STATS_MAX
+}
+
+void PLYStats::add(const miniply::PLYReaderStats& reader) {
+    header_ns += int64_t(reader.headerNs);
+    read_ns += int64_t(reader.readNs);
+    load_ns += int64_t(reader.loadNs);
+    swap_ns += int64_t(reader.swapNs);
+    list_ns += int64_t(reader.listNs);
+    extract_ns += int64_t(reader.extractNs);
+    convert_ns += int64_t(reader.convertNs);
+    bytes_read += int64_t(reader.bytesRead);
+    refills += int64_t(reader.refills);
+    memmoves += int64_t(reader.memmoves);
+    memmove_bytes += int64_t(reader.memmoveBytes);
+    conversions += int64_t(reader.conversions);
+    allocations += int64_t(reader.allocations);
+    allocated_bytes += int64_t(reader.allocatedBytes);
+    copied_bytes += int64_t(reader.copiedBytes);
+    peak_transient_bytes += int64_t(reader.peakBytes);
+}
+
+std::vector<std::pair<std::string, int64_t>> PLYStats::items() const {
+    std::vector<std::pair<std::string, int64_t>> result;
+#define PLYTORCH_STATS_ITEM(name) result.emplace_back(#name, name);
+    PLYTORCH_STATS_FIELDS(PLYTORCH_STATS_ITEM)
+    PLYTORCH_STATS_PEAK_FIELDS(PLYTORCH_STATS_ITEM)
+#undef PLYTORCH_STATS_ITEM
+    return result;
+}
+
+void set_profiling(bool enabled) {
+    g_profiling.store(enabled, std::memory_order_relaxed);
+}
+
+bool profiling_enabled() {
+    return g_profiling.load(std::memory_order_relaxed);
+}
+
+void add_global_stats(const PLYStats& stats) {
+    std::lock_guard<std::mutex> lock(g_global_stats_mutex);
+    g_global_stats.add(stats);
+}
+
+PLYStats global_stats(bool reset) {
+    std::lock_guard<std::mutex> lock(g_global_stats_mutex);
+    PLYStats result = g_global_stats;
+    if (reset) {
+        g_global_stats = PLYStats();
+    }
+    return result;
+}
@@ -0,0 +1,115 @@
+#ifndef PLYTORCH_PLY_STATS_H
+#define PLYTORCH_PLY_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "miniply.h"
+
+
+// Every field of `PLYStats`. Times are in nanoseconds and don't overlap, so
+// the phases of a call add up to (nearly) its total_ns.
+#define PLYTORCH_STATS_FIELDS(X) \
+    X(calls)                     \
+    X(total_ns)                  \
+    X(header_ns)                 \
+    X(read_ns)                   \
+    X(load_ns)                   \
+    X(swap_ns)                   \
+    X(list_ns)                   \
+    X(extract_ns)                \
+    X(convert_ns)                \
+    X(index_ns)                  \
+    X(allocate_ns)               \
+    X(postprocess_ns)            \
+    X(interleave_ns)             \
+    X(compress_ns)               \
+    X(write_ns)                  \
+    X(bytes_read)                \
+    X(refills)                   \
+    X(memmoves)                  \
+    X(memmove_bytes)             \
+    X(conversions)               \
+    X(allocations)               \
+    X(allocated_bytes)           \
+    X(copied_bytes)              \
+    X(bytes_written)             \
+    X(buffered_reads)            \
+    X(parallel_reads)            \
+    X(mapped_reads)              \
+    X(stream_reads)              \
+    X(mapped_writes)
+
+// High-water marks of `PLYStats`. Summed over the readers of one call, which
+// may hold their memory at the same time, and the maximum over many calls.
+#define PLYTORCH_STATS_PEAK_FIELDS(X) \
+    X(peak_transient_bytes)
+
+// Where the time of reads and writes went and how much work they did, for one
+// call or summed over many:
+// - header_ns, read_ns (including decompression), load_ns (fixed-size and
+//   ASCII elements), swap_ns (big-endian data), list_ns (variable-size
+//   elements), extract_ns and convert_ns (copying values out of the reader,
+//   as they are or converted) come from the readers;
+// - index_ns is spent converting and validating vertex index lists,
+//   allocate_ns allocating tensors, postprocess_ns welding and deriving
+//   normals and adjacency;
+// - interleave_ns, compress_ns and write_ns are spent writing;
+// - allocations and allocated_bytes count the output tensors and the buffers
+//   the readers (re)allocate, copied_bytes the bytes copied into the readers
+//   and out of them, peak_transient_bytes the most memory the readers held
+//   besides the output tensors;
+// - buffered_reads, parallel_reads, mapped_reads and stream_reads count the
+//   files read with each strategy, see ReadPlan, and mapped_writes the files
+//   written through a memory mapping.
+struct PLYStats {
+#define PLYTORCH_STATS_DECLARE(name) int64_t name = 0;
+    PLYTORCH_STATS_FIELDS(PLYTORCH_STATS_DECLARE)
+    PLYTORCH_STATS_PEAK_FIELDS(PLYTORCH_STATS_DECLARE)
+#undef PLYTORCH_STATS_DECLARE
+
+    void add(const PLYStats& other);
+    void add(const miniply::PLYReaderStats& reader);
+
+    // (name, value) of every field, in the order above.
+    std::vector<std::pair<std::string, int64_t>> items() const;
+};
+
+// Adds the time between its construction and destruction to `phase` of
+// `stats`. Does nothing if `stats` is null.
+class PLYStatsTimer {
+public:
+    PLYStatsTimer(PLYStats* stats, int64_t PLYStats::* phase) : m_stats(stats), m_phase(phase) {
+        if (m_stats != nullptr) {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~PLYStatsTimer() {
+        if (m_stats != nullptr) {
+            m_stats->*m_phase += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - m_start).count();
+        }
+    }
+
+    PLYStatsTimer(const PLYStatsTimer&) = delete;
+    PLYStatsTimer& operator=(const PLYStatsTimer&) = delete;
+
+private:
+    PLYStats* m_stats;
+    int64_t PLYStats::* m_phase;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Whether every read and write is profiled, not only those that ask for it.
+void set_profiling(bool enabled);
+bool profiling_enabled();
+
+// Process-wide totals over all profiled calls, since startup or the last reset.
+void add_global_stats(const PLYStats& stats);
+PLYStats global_stats(bool reset);
+
+#endif // PLYTORCH_PLY_STATS_H
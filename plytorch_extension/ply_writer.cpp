@@ -0,0 +1,796 @@
+#include "ply_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "parallel.h"
+
+
+namespace {
+
+// Rows are interleaved in blocks of about this many bytes per thread.
+constexpr int64_t kWriteGrainBytes = 1 << 16;
+
+bool is_big_endian() {
+    const uint32_t one = 1;
+    char first_byte;
+    std::memcpy(&first_byte, &one, 1);
+    return first_byte == 0;
+}
+
+// Most characters a single value takes as text: 24 for a double with the
+// fewest round-trip digits, fewer for the other types and for at most
+// kMaxPrecision significant digits.
+constexpr int64_t kMaxValueChars = 32;
+constexpr int kMaxPrecision = 17;
+
+int64_t value_stride(const PLYWriteProperty& property) {
+    return property.value_stride >= 0 ? property.value_stride : int64_t(property.value_size);
+}
+
+int64_t row_stride(const PLYWriteProperty& property) {
+    return property.stride >= 0 ? property.stride : value_stride(property) * property.list_size;
+}
+
+bool is_ragged(const PLYWriteProperty& property) {
+    return property.offsets != nullptr;
+}
+
+bool has_ragged_lists(const PLYWriteElement& element) {
+    return std::any_of(element.properties.begin(), element.properties.end(), is_ragged);
+}
+
+// Number of values of `property` in rows [row_begin, row_end).
+int64_t num_values(const PLYWriteProperty& property, int64_t row_begin, int64_t row_end) {
+    if (is_ragged(property)) {
+        return property.offsets[row_end] - property.offsets[row_begin];
+    }
+    return (row_end - row_begin) * property.list_size;
+}
+
+const char* count_type_name(uint32_t count_size) {
+    switch (count_size) {
+    case 2:
+        return "ushort";
+    case 4:
+        return "uint";
+    default:
+        return "uchar";
+    }
+}
+
+bool swaps_bytes(PLYByteOrder byte_order) {
+    switch (byte_order) {
+    case PLYByteOrder::LittleEndian:
+        return is_big_endian();
+    case PLYByteOrder::BigEndian:
+        return !is_big_endian();
+    default:
+        return false;
+    }
+}
+
+template <size_t Size> struct SwapWord;
+template <> struct SwapWord<2> { using type = uint16_t; };
+template <> struct SwapWord<4> { using type = uint32_t; };
+template <> struct SwapWord<8> { using type = uint64_t; };
+
+// Reverses the bytes of `value`. Compilers turn the shifts into a single
+// bswap (or rev) instruction, so swapping costs no more than the copy.
+inline uint16_t byte_swapped(uint16_t value) {
+    return uint16_t((value >> 8) | (value << 8));
+}
+
+inline uint32_t byte_swapped(uint32_t value) {
+    value = (value >> 16) | (value << 16);
+    return ((value & 0xFF00FF00u) >> 8) | ((value & 0x00FF00FFu) << 8);
+}
+
+inline uint64_t byte_swapped(uint64_t value) {
+    value = (value >> 32) | (value << 32);
+    value = ((value & 0xFFFF0000FFFF0000ull) >> 16) | ((value & 0x0000FFFF0000FFFFull) << 16);
+    return ((value & 0xFF00FF00FF00FF00ull) >> 8) | ((value & 0x00FF00FF00FF00FFull) << 8);
+}
+
+// Copies a value of `Size` bytes, reversing its bytes if `Swap`.
+template <size_t Size, bool Swap>
+inline void copy_value(char* dest, const char* src) {
+    if constexpr (Swap && Size > 1) {
+        typename SwapWord<Size>::type value;
+        std::memcpy(&value, src, Size);
+        value = byte_swapped(value);
+        std::memcpy(dest, &value, Size);
+    } else {
+        std::memcpy(dest, src, Size);
+    }
+}
+
+// Copies `rows` values of `Size` bytes from every `src_stride`-th byte of
+// `src` to every `dest_stride`-th byte of `dest`.
+template <size_t Size, bool Swap>
+void scatter_values(const char* src, int64_t src_stride, int64_t rows, char* dest, int64_t dest_stride) {
+    for (int64_t row = 0; row != rows; ++row) {
+        copy_value<Size, Swap>(dest, src);
+        src += src_stride;
+        dest += dest_stride;
+    }
+}
+
+// Writes the list length `count` as `count_size` bytes.
+template <bool Swap>
+inline void write_count(char* dest, int64_t count, uint32_t count_size) {
+    if (count_size == 1) {
+        dest[0] = char(count);
+    } else if (count_size == 2) {
+        uint16_t value = uint16_t(count);
+        copy_value<2, Swap>(dest, reinterpret_cast<const char*>(&value));
+    } else {
+        uint32_t value = uint32_t(count);
+        copy_value<4, Swap>(dest, reinterpret_cast<const char*>(&value));
+    }
+}
+
+// The same for `count` values per row, `src_value_stride` bytes apart,
+// written after their count of `count_size` bytes.
+template <size_t Size, bool Swap>
+void scatter_lists(const char* src, int64_t src_stride, int64_t src_value_stride, int64_t rows, uint32_t count,
+                   uint32_t count_size, char* dest, int64_t dest_stride) {
+    char encoded_count[4];
+    write_count<Swap>(encoded_count, count, count_size);
+    for (int64_t row = 0; row != rows; ++row) {
+        std::memcpy(dest, encoded_count, count_size);
+        for (uint32_t i = 0; i != count; ++i) {
+            copy_value<Size, Swap>(dest + count_size + i * Size, src + i * src_value_stride);
+        }
+        src += src_stride;
+        dest += dest_stride;
+    }
+}
+
+// The same for runs of `count` adjacent values per row, such as the columns
+// of an [N, C] tensor written as C consecutive properties.
+template <size_t Size, bool Swap>
+void scatter_runs(const char* src, int64_t src_stride, int64_t rows, uint32_t count, char* dest,
+                  int64_t dest_stride) {
+    const size_t run_bytes = size_t(count) * Size;
+    for (int64_t row = 0; row != rows; ++row) {
+        if constexpr (Swap && Size > 1) {
+            for (uint32_t i = 0; i != count; ++i) {
+                copy_value<Size, true>(dest + i * Size, src + i * Size);
+            }
+        } else {
+            std::memcpy(dest, src, run_bytes);
+        }
+        src += src_stride;
+        dest += dest_stride;
+    }
+}
+
+// Consecutive scalar properties whose values are also adjacent in memory,
+// scattered together.
+struct ScatterRun {
+    const PLYWriteProperty* first;
+    uint32_t count;
+    int64_t offset;  // In the row.
+};
+
+std::vector<ScatterRun> scatter_runs_of(const PLYWriteElement& element) {
+    std::vector<ScatterRun> runs;
+    int64_t offset = 0;
+    for (const PLYWriteProperty& property : element.properties) {
+        if (!runs.empty()) {
+            ScatterRun& run = runs.back();
+            const PLYWriteProperty& last = run.first[run.count - 1];
+            bool adjacent = !property.is_list && !last.is_list && property.value_size == last.value_size &&
+                            row_stride(property) == row_stride(last) &&
+                            property.data == last.data + last.value_size;
+            if (adjacent) {
+                run.count++;
+                offset += property.value_size;
+                continue;
+            }
+        }
+        runs.push_back({&property, 1, offset});
+        offset += int64_t(property.value_size) * property.list_size + (property.is_list ? property.count_size : 0);
+    }
+    return runs;
+}
+
+template <bool Swap>
+void scatter_run(const ScatterRun& run, int64_t row_begin, int64_t rows, char* dest, int64_t dest_stride) {
+    const PLYWriteProperty& first = *run.first;
+    const int64_t src_stride = row_stride(first);
+    const char* src = first.data + row_begin * src_stride;
+    switch (first.value_size) {
+    case 1:
+        scatter_runs<1, Swap>(src, src_stride, rows, run.count, dest, dest_stride);
+        break;
+    case 2:
+        scatter_runs<2, Swap>(src, src_stride, rows, run.count, dest, dest_stride);
+        break;
+    case 4:
+        scatter_runs<4, Swap>(src, src_stride, rows, run.count, dest, dest_stride);
+        break;
+    case 8:
+        scatter_runs<8, Swap>(src, src_stride, rows, run.count, dest, dest_stride);
+        break;
+    default:
+        throw std::runtime_error("cannot write values of " + std::to_string(first.value_size) +
+                                 " bytes of property '" + first.name + "'");
+    }
+}
+
+template <bool Swap>
+void scatter_property(const PLYWriteProperty& property, int64_t row_begin, int64_t rows, char* dest,
+                      int64_t dest_stride) {
+    const int64_t row_bytes = int64_t(property.value_size) * property.list_size;
+    const int64_t src_stride = row_stride(property);
+    const int64_t src_value_stride = value_stride(property);
+    const char* src = property.data + row_begin * src_stride;
+
+    if (property.is_list) {
+        const uint32_t count = property.list_size;
+        switch (property.value_size) {
+        case 1:
+            scatter_lists<1, Swap>(src, src_stride, src_value_stride, rows, count, property.count_size, dest,
+                                    dest_stride);
+            break;
+        case 2:
+            scatter_lists<2, Swap>(src, src_stride, src_value_stride, rows, count, property.count_size, dest,
+                                    dest_stride);
+            break;
+        case 4:
+            scatter_lists<4, Swap>(src, src_stride, src_value_stride, rows, count, property.count_size, dest,
+                                    dest_stride);
+            break;
+        case 8:
+            scatter_lists<8, Swap>(src, src_stride, src_value_stride, rows, count, property.count_size, dest,
+                                    dest_stride);
+            break;
+        default:
+            throw std::runtime_error("cannot write values of " + std::to_string(property.value_size) +
+                                     " bytes of property '" + property.name + "'");
+        }
+        return;
+    }
+
+    switch (property.value_size) {
+    case 1:
+        scatter_values<1, Swap>(src, src_stride, rows, dest, dest_stride);
+        break;
+    case 2:
+        scatter_values<2, Swap>(src, src_stride, rows, dest, dest_stride);
+        break;
+    case 4:
+        scatter_values<4, Swap>(src, src_stride, rows, dest, dest_stride);
+        break;
+    case 8:
+        scatter_values<8, Swap>(src, src_stride, rows, dest, dest_stride);
+        break;
+    default:
+        if (Swap) {
+            throw std::runtime_error("cannot byte-swap values of " + std::to_string(property.value_size) +
+                                     " bytes of property '" + property.name + "'");
+        }
+        for (int64_t row = 0; row != rows; ++row) {
+            std::memcpy(dest, src, row_bytes);
+            src += src_stride;
+            dest += dest_stride;
+        }
+        break;
+    }
+}
+
+// Writes row `row` of `property` to `dest` and returns the end of the row.
+// Elements with ragged lists are written row by row with these, as their rows
+// have no fixed size.
+using WriteRow = char* (*)(const PLYWriteProperty& property, int64_t row, char* dest);
+
+template <size_t Size, bool Swap>
+char* write_row(const PLYWriteProperty& property, int64_t row, char* dest) {
+    const int64_t src_value_stride = value_stride(property);
+    const char* src;
+    int64_t count;
+    if (is_ragged(property)) {
+        src = property.data + property.offsets[row] * src_value_stride;
+        count = property.offsets[row + 1] - property.offsets[row];
+    } else {
+        src = property.data + row * row_stride(property);
+        count = property.list_size;
+    }
+    if (property.is_list) {
+        write_count<Swap>(dest, count, property.count_size);
+        dest += property.count_size;
+    }
+    if (!Swap && src_value_stride == int64_t(Size)) {
+        std::memcpy(dest, src, size_t(count) * Size);
+        return dest + count * int64_t(Size);
+    }
+    for (int64_t i = 0; i != count; ++i) {
+        copy_value<Size, Swap>(dest, src);
+        src += src_value_stride;
+        dest += Size;
+    }
+    return dest;
+}
+
+template <bool Swap>
+WriteRow row_writer(const PLYWriteProperty& property) {
+    switch (property.value_size) {
+    case 1:
+        return write_row<1, Swap>;
+    case 2:
+        return write_row<2, Swap>;
+    case 4:
+        return write_row<4, Swap>;
+    case 8:
+        return write_row<8, Swap>;
+    default:
+        throw std::runtime_error("cannot write values of " + std::to_string(property.value_size) +
+                                 " bytes of property '" + property.name + "'");
+    }
+}
+
+// Writes rows [row_begin, row_end) of an element with ragged lists. The
+// offsets of the lists are prefix sums of their lengths, so where each block
+// of rows starts is known without a pass over the rows before it, and blocks
+// are written in parallel.
+void write_ragged_rows(const PLYWriteElement& element, int64_t row_begin, int64_t row_end, char* dest, bool swap) {
+    std::vector<WriteRow> writers;
+    for (const PLYWriteProperty& property : element.properties) {
+        writers.push_back(swap ? row_writer<true>(property) : row_writer<false>(property));
+    }
+    if (row_begin >= row_end) {
+        return;
+    }
+    const int64_t average_row_size = std::max<int64_t>(1, ply_rows_size(element, row_begin, row_end) /
+                                                              (row_end - row_begin));
+    const int64_t grain_size = std::max<int64_t>(1, kWriteGrainBytes / average_row_size);
+
+    parallel_for(row_begin, row_end, grain_size, [&](int64_t block_begin, int64_t block_end) {
+        char* row_dest = dest + ply_rows_size(element, row_begin, block_begin);
+        for (int64_t row = block_begin; row != block_end; ++row) {
+            for (size_t i = 0; i != writers.size(); ++i) {
+                row_dest = writers[i](element.properties[i], row, row_dest);
+            }
+        }
+    });
+}
+
+// Writes the value at `src` as text to `dest`, which must have room for
+// kMaxValueChars characters, and returns the end of the text.
+using FormatValue = char* (*)(const char* src, char* dest, int precision);
+
+template <class T>
+char* format_integer(const char* src, char* dest, int) {
+    T value;
+    std::memcpy(&value, src, sizeof(T));
+    return std::to_chars(dest, dest + kMaxValueChars, value).ptr;
+}
+
+// std::to_chars without a precision writes the shortest text that reads back
+// as the same value.
+template <class T>
+char* format_floating_point(const char* src, char* dest, int precision) {
+    T value;
+    std::memcpy(&value, src, sizeof(T));
+    if (precision > 0) {
+        return std::to_chars(dest, dest + kMaxValueChars, value, std::chars_format::general, precision).ptr;
+    }
+    return std::to_chars(dest, dest + kMaxValueChars, value).ptr;
+}
+
+FormatValue value_formatter(const PLYWriteProperty& property) {
+    const std::string& type = property.type;
+    if (type == "char") {
+        return format_integer<int8_t>;
+    } else if (type == "uchar") {
+        return format_integer<uint8_t>;
+    } else if (type == "short") {
+        return format_integer<int16_t>;
+    } else if (type == "ushort") {
+        return format_integer<uint16_t>;
+    } else if (type == "int") {
+        return format_integer<int32_t>;
+    } else if (type == "uint") {
+        return format_integer<uint32_t>;
+    } else if (type == "float") {
+        return format_floating_point<float>;
+    } else if (type == "double") {
+        return format_floating_point<double>;
+    }
+    throw std::runtime_error("cannot write values of type '" + type + "' of property '" + property.name +
+                             "' as text");
+}
+
+struct TextColumn {
+    FormatValue format;
+    const char* data;
+    int64_t stride;
+    int64_t value_stride;
+    uint32_t list_size;
+    bool is_list;
+    const int64_t* offsets;
+};
+
+// Formats rows [row_begin, row_end) into `dest`, which must have room for
+// their ASCII row bound, and returns the end of the text.
+char* format_rows(const std::vector<TextColumn>& columns, int64_t row_begin, int64_t row_end, int precision,
+                  char* dest) {
+    for (int64_t row = row_begin; row != row_end; ++row) {
+        if (columns.empty()) {
+            *dest++ = '\n';
+            continue;
+        }
+        for (const TextColumn& column : columns) {
+            const char* src = column.data + row * column.stride;
+            int64_t count = column.list_size;
+            if (column.offsets != nullptr) {
+                src = column.data + column.offsets[row] * column.value_stride;
+                count = column.offsets[row + 1] - column.offsets[row];
+            }
+            if (column.is_list) {
+                dest = std::to_chars(dest, dest + kMaxValueChars, count).ptr;
+                *dest++ = ' ';
+            }
+            for (int64_t i = 0; i != count; ++i) {
+                dest = column.format(src, dest, precision);
+                *dest++ = ' ';
+                src += column.value_stride;
+            }
+        }
+        dest[-1] = '\n';
+    }
+    return dest;
+}
+
+// Rows written into a mapped file are interleaved in blocks of about this
+// many bytes, small enough to stay in cache, then copied out in one pass.
+constexpr int64_t kStageBytes = 1 << 18;
+
+// Writes the binary body of `element` into `dest` as `write_ply_rows`, but
+// each thread interleaves blocks of rows in a scratch buffer of its own and
+// copies them to `dest` front to back. Property by property interleaving
+// touches every byte of a block once per property, which is cheap in cache
+// but not in freshly mapped pages: each of them would be faulted in and
+// dirtied piecemeal.
+void write_rows_staged(const PLYWriteElement& element, char* dest, PLYByteOrder byte_order) {
+    int64_t row_size = std::max<int64_t>(ply_row_size(element), 1);
+    int64_t grain_size = std::max<int64_t>(1, kStageBytes / row_size);
+    parallel_for(0, element.count, grain_size, [&](int64_t chunk_begin, int64_t chunk_end) {
+        // Blocks are already spread over the threads.
+        ScopedWorkerThreadLimit limit(1);
+        std::vector<char> scratch;
+        char* block_dest = dest + ply_rows_size(element, 0, chunk_begin);
+        for (int64_t row = chunk_begin, row_end; row < chunk_end; row = row_end) {
+            row_end = std::min(chunk_end, ply_chunk_end(element, row, kStageBytes, PLYWriteFormat::Binary));
+            size_t size = size_t(ply_rows_size(element, row, row_end));
+            scratch.resize(size);
+            write_ply_rows(element, row, row_end, scratch.data(), byte_order);
+            std::memcpy(block_dest, scratch.data(), size);
+            block_dest += size;
+        }
+    });
+}
+
+#ifndef _WIN32
+// fdatasync where there is one: it skips metadata that isn't needed to read
+// the data back, such as the modification time.
+int sync_data(int fd) {
+#ifdef __APPLE__
+    return ::fsync(fd);
+#else
+    return ::fdatasync(fd);
+#endif
+}
+#endif
+
+} // namespace
+
+
+PLYWriteFormat parse_write_format(const std::string& name) {
+    if (name == "binary") {
+        return PLYWriteFormat::Binary;
+    } else if (name == "ascii") {
+        return PLYWriteFormat::ASCII;
+    }
+    throw std::runtime_error("unknown PLY format '" + name + "', expected binary or ascii");
+}
+
+PLYByteOrder parse_byte_order(const std::string& name) {
+    if (name == "native") {
+        return PLYByteOrder::Native;
+    } else if (name == "little") {
+        return PLYByteOrder::LittleEndian;
+    } else if (name == "big") {
+        return PLYByteOrder::BigEndian;
+    }
+    throw std::runtime_error("unknown byte order '" + name + "', expected native, little or big");
+}
+
+uint32_t parse_count_type(const std::string& name) {
+    if (name == "uchar") {
+        return 1;
+    } else if (name == "ushort") {
+        return 2;
+    } else if (name == "uint") {
+        return 4;
+    }
+    throw std::runtime_error("unknown list count type '" + name + "', expected uchar, ushort or uint");
+}
+
+uint32_t count_size_for(int64_t max_count) {
+    if (max_count <= 0xFF) {
+        return 1;
+    }
+    return max_count <= 0xFFFF ? 2 : 4;
+}
+
+
+std::string ply_header(const std::vector<PLYWriteElement>& elements, PLYWriteFormat format,
+                       PLYByteOrder byte_order, bool appendable) {
+    std::string header = "ply\n";
+    if (format == PLYWriteFormat::ASCII) {
+        header += "format ascii 1.0\n";
+    } else {
+        bool big_endian = is_big_endian() != swaps_bytes(byte_order);
+        header += big_endian ? "format binary_big_endian 1.0\n" : "format binary_little_endian 1.0\n";
+    }
+    for (const PLYWriteElement& element : elements) {
+        std::string count = std::to_string(element.count);
+        if (appendable && &element == &elements.back()) {
+            count.resize(std::max(count.size(), kAppendableCountWidth), ' ');
+        }
+        header += "element " + element.name + " " + count + "\n";
+        for (const PLYWriteProperty& property : element.properties) {
+            header += property.is_list ? std::string("property list ") + count_type_name(property.count_size) + " "
+                                       : std::string("property ");
+            header += property.type + " " + property.name + "\n";
+        }
+    }
+    header += "end_header\n";
+    return header;
+}
+
+int64_t ply_row_size(const PLYWriteElement& element) {
+    int64_t size = 0;
+    for (const PLYWriteProperty& property : element.properties) {
+        size += property.is_list ? property.count_size : 0;
+        if (!is_ragged(property)) {
+            size += int64_t(property.value_size) * property.list_size;
+        }
+    }
+    return size;
+}
+
+int64_t ply_rows_size(const PLYWriteElement& element, int64_t row_begin, int64_t row_end) {
+    int64_t size = 0;
+    for (const PLYWriteProperty& property : element.properties) {
+        size += (property.is_list ? property.count_size : 0) * (row_end - row_begin);
+        size += int64_t(property.value_size) * num_values(property, row_begin, row_end);
+    }
+    return size;
+}
+
+int64_t ply_body_size(const std::vector<PLYWriteElement>& elements) {
+    int64_t size = 0;
+    for (const PLYWriteElement& element : elements) {
+        size += ply_rows_size(element, 0, element.count);
+    }
+    return size;
+}
+
+int64_t ply_chunk_end(const PLYWriteElement& element, int64_t row_begin, int64_t max_bytes, PLYWriteFormat format) {
+    if (row_begin >= element.count) {
+        return element.count;
+    }
+    auto size = [&](int64_t row_end) {
+        return format == PLYWriteFormat::ASCII ? ply_ascii_rows_bound(element, row_begin, row_end)
+                                               : ply_rows_size(element, row_begin, row_end);
+    };
+    if (!has_ragged_lists(element)) {
+        int64_t rows = max_bytes / std::max<int64_t>(size(row_begin + 1), 1);
+        return std::min(element.count, row_begin + std::max<int64_t>(rows, 1));
+    }
+    // Sizes grow with the end row, so the last end that fits is found by bisection.
+    int64_t low = row_begin + 1;
+    int64_t high = element.count;
+    while (low < high) {
+        int64_t middle = low + (high - low + 1) / 2;
+        if (size(middle) <= max_bytes) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+void write_ply_rows(const PLYWriteElement& element, int64_t row_begin, int64_t row_end, char* dest,
+                    PLYByteOrder byte_order) {
+    const bool swap = swaps_bytes(byte_order);
+    if (has_ragged_lists(element)) {
+        write_ragged_rows(element, row_begin, row_end, dest, swap);
+        return;
+    }
+    const int64_t row_size = ply_row_size(element);
+    if (row_size == 0) {
+        return;
+    }
+    const int64_t grain_size = std::max<int64_t>(1, kWriteGrainBytes / row_size);
+    const std::vector<ScatterRun> runs = scatter_runs_of(element);
+
+    // Every property (or run of them) is scattered column by column over a
+    // block of rows, so the copy size (and whether to swap) is fixed within
+    // each inner loop.
+    parallel_for(row_begin, row_end, grain_size, [&](int64_t block_begin, int64_t block_end) {
+        char* block_dest = dest + (block_begin - row_begin) * row_size;
+        const int64_t rows = block_end - block_begin;
+        for (const ScatterRun& run : runs) {
+            if (run.count > 1) {
+                if (swap) {
+                    scatter_run<true>(run, block_begin, rows, block_dest + run.offset, row_size);
+                } else {
+                    scatter_run<false>(run, block_begin, rows, block_dest + run.offset, row_size);
+                }
+            } else if (swap) {
+                scatter_property<true>(*run.first, block_begin, rows, block_dest + run.offset, row_size);
+            } else {
+                scatter_property<false>(*run.first, block_begin, rows, block_dest + run.offset, row_size);
+            }
+        }
+    });
+}
+
+void write_ply_column(const PLYWriteProperty& property, int64_t row_begin, int64_t row_end, char* dest,
+                      int64_t dest_stride, PLYByteOrder byte_order) {
+    if (is_ragged(property)) {
+        throw std::runtime_error("list property '" + property.name + "' of varying length has no fixed place in rows");
+    }
+    const bool swap = swaps_bytes(byte_order);
+    const int64_t grain_size = std::max<int64_t>(1, kWriteGrainBytes / std::max<int64_t>(dest_stride, 1));
+    parallel_for(row_begin, row_end, grain_size, [&](int64_t block_begin, int64_t block_end) {
+        char* block_dest = dest + (block_begin - row_begin) * dest_stride;
+        if (swap) {
+            scatter_property<true>(property, block_begin, block_end - block_begin, block_dest, dest_stride);
+        } else {
+            scatter_property<false>(property, block_begin, block_end - block_begin, block_dest, dest_stride);
+        }
+    });
+}
+
+void write_ply_body(const std::vector<PLYWriteElement>& elements, char* dest, PLYByteOrder byte_order) {
+    for (const PLYWriteElement& element : elements) {
+        write_ply_rows(element, 0, element.count, dest, byte_order);
+        dest += ply_rows_size(element, 0, element.count);
+    }
+}
+
+bool write_ply_mapped(const std::string& path, const std::string& header,
+                      const std::vector<PLYWriteElement>& elements, PLYByteOrder byte_order, bool sync) {
+#ifdef _WIN32
+    return false;
+#else
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0 && !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        throw std::runtime_error("Could not create file: " + path + " (" + std::strerror(errno) + ")");
+    }
+    const size_t size = header.size() + size_t(ply_body_size(elements));
+#ifdef __linux__
+    // Blocks are allocated now rather than when pages are first written back,
+    // so that running out of space is an error here instead of a SIGBUS while
+    // filling the mapping. Filesystems that can't reserve space just skip it.
+    if (::fallocate(fd, 0, 0, off_t(size)) != 0 && errno == ENOSPC) {
+        ::close(fd);
+        throw std::runtime_error("Not enough space for " + std::to_string(size) + " bytes: " + path);
+    }
+#endif
+    if (::ftruncate(fd, off_t(size)) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Could not resize " + path + " to " + std::to_string(size) + " bytes (" +
+                                 std::strerror(error) + ")");
+    }
+    void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    char* dest = static_cast<char*>(addr);
+    std::memcpy(dest, header.data(), header.size());
+    dest += header.size();
+    for (const PLYWriteElement& element : elements) {
+        write_rows_staged(element, dest, byte_order);
+        dest += ply_rows_size(element, 0, element.count);
+    }
+
+    bool synced = !sync || (::msync(addr, size, MS_SYNC) == 0 && sync_data(fd) == 0);
+    int error = errno;
+    ::munmap(addr, size);
+    ::close(fd);
+    if (!synced) {
+        throw std::runtime_error("Failed to sync " + path + " (" + std::strerror(error) + ")");
+    }
+    return true;
+#endif
+}
+
+void sync_file(const std::string& path) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || sync_data(fd) != 0) {
+        int error = errno;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        throw std::runtime_error("Failed to sync " + path + " (" + std::strerror(error) + ")");
+    }
+    ::close(fd);
+#endif
+}
+
+int64_t ply_ascii_rows_bound(const PLYWriteElement& element, int64_t row_begin, int64_t row_end) {
+    int64_t size = row_end - row_begin;
+    for (const PLYWriteProperty& property : element.properties) {
+        int64_t counts = property.is_list ? row_end - row_begin : 0;
+        size += (kMaxValueChars + 1) * (num_values(property, row_begin, row_end) + counts);
+    }
+    return size;
+}
+
+void format_ply_rows(const PLYWriteElement& element, int64_t row_begin, int64_t row_end, int precision,
+                     std::string& dest) {
+    if (row_begin >= row_end) {
+        return;
+    }
+    precision = std::clamp(precision, 0, kMaxPrecision);
+
+    std::vector<TextColumn> columns;
+    for (const PLYWriteProperty& property : element.properties) {
+        columns.push_back({value_formatter(property), property.data, row_stride(property), value_stride(property),
+                           property.list_size, property.is_list, property.offsets});
+    }
+
+    // The length of the text is only known once formatted, so each block of
+    // rows is formatted into a scratch buffer sized for the longest text and
+    // kept at its actual length.
+    const int64_t rows = row_end - row_begin;
+    const int64_t row_bound = std::max<int64_t>(1, ply_ascii_rows_bound(element, row_begin, row_end) / rows);
+    const int64_t block_rows = std::max<int64_t>(1, kWriteGrainBytes / row_bound);
+    const int64_t num_blocks = (rows + block_rows - 1) / block_rows;
+    std::vector<std::string> blocks(static_cast<size_t>(num_blocks));
+    parallel_for(0, num_blocks, 1, [&](int64_t first_block, int64_t last_block) {
+        std::vector<char> scratch;
+        for (int64_t block = first_block; block != last_block; ++block) {
+            int64_t begin = row_begin + block * block_rows;
+            int64_t end = std::min(row_end, begin + block_rows);
+            scratch.resize(std::max(scratch.size(), size_t(ply_ascii_rows_bound(element, begin, end))));
+            char* text_end = format_rows(columns, begin, end, precision, scratch.data());
+            blocks[size_t(block)].assign(scratch.data(), text_end);
+        }
+    });
+
+    size_t size = dest.size();
+    for (const std::string& text : blocks) {
+        size += text.size();
+    }
+    dest.reserve(size);
+    for (const std::string& text : blocks) {
+        dest += text;
+    }
+}
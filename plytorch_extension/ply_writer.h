@@ -0,0 +1,128 @@
+#ifndef PLYTORCH_PLY_WRITER_H
+#define PLYTORCH_PLY_WRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Encoding of the body of a written PLY file.
+enum class PLYWriteFormat { Binary, ASCII };
+
+// "binary" or "ascii". Throws std::runtime_error for other names.
+PLYWriteFormat parse_write_format(const std::string& name);
+
+// Byte order of written binary data. Values are byte-swapped while rows are
+// interleaved when it isn't that of this machine.
+enum class PLYByteOrder { Native, LittleEndian, BigEndian };
+
+// "native", "little" or "big". Throws std::runtime_error for other names.
+PLYByteOrder parse_byte_order(const std::string& name);
+
+// Bytes of the list length type named "uchar", "ushort" or "uint". Throws
+// std::runtime_error for other names.
+uint32_t parse_count_type(const std::string& name);
+
+// Bytes of the smallest list length type holding lengths up to `max_count`.
+uint32_t count_size_for(int64_t max_count);
+
+// One property of an element to be written. `data` holds `list_size` values
+// per row (one for scalar properties), `value_stride` bytes apart, and rows
+// are `stride` bytes apart, so columns of [N, C] tensors and other strided
+// views are gathered as they are. Strides may be zero (e.g. for expanded
+// tensors) and default to values and rows back to back.
+//
+// Lists of varying length are given in CSR form: row i holds the values
+// offsets[i] to offsets[i + 1] (exclusive) of `data`, `value_stride` bytes
+// apart, and `list_size` and `stride` are unused.
+struct PLYWriteProperty {
+    std::string name;
+    std::string type;         // PLY type name of the values, e.g. "float".
+    uint32_t value_size = 0;  // Bytes per value.
+    const char* data = nullptr;
+    bool is_list = false;     // Written as "property list <count type> <type>", each row prefixed with its length.
+    uint32_t list_size = 1;
+    uint32_t count_size = 1;  // Bytes of the length of each list: 1, 2 or 4 (uchar, ushort or uint).
+    int64_t stride = -1;       // Bytes from one row to the next, -1 for rows back to back.
+    int64_t value_stride = -1; // Bytes from one value of a row to the next, -1 for values back to back.
+    const int64_t* offsets = nullptr;  // count + 1 offsets of ragged lists, null for lists of list_size values.
+};
+
+struct PLYWriteElement {
+    std::string name;
+    int64_t count = 0;
+    std::vector<PLYWriteProperty> properties;
+};
+
+// Characters the row count of the last element takes in headers written to
+// be appended to: more than any count miniply reads (at most INT32_MAX) takes.
+constexpr size_t kAppendableCountWidth = 20;
+
+// PLY header for `elements`, declaring binary data in `byte_order`. With
+// `appendable`, the row count of the last element is padded with spaces to
+// kAppendableCountWidth characters, so that it can be rewritten in place as
+// rows are appended.
+std::string ply_header(const std::vector<PLYWriteElement>& elements,
+                       PLYWriteFormat format = PLYWriteFormat::Binary,
+                       PLYByteOrder byte_order = PLYByteOrder::Native,
+                       bool appendable = false);
+
+// Bytes taken by one row of `element` in the binary body, not counting the
+// values of ragged lists.
+int64_t ply_row_size(const PLYWriteElement& element);
+
+// Bytes taken by rows [row_begin, row_end) of `element` in the binary body.
+int64_t ply_rows_size(const PLYWriteElement& element, int64_t row_begin, int64_t row_end);
+
+// Exact size of the binary body of `elements`, i.e. the file without its header.
+int64_t ply_body_size(const std::vector<PLYWriteElement>& elements);
+
+// End of the most rows of `element` from `row_begin` on (at least one) that
+// take at most `max_bytes` in `format`, as text by `ply_ascii_rows_bound`.
+int64_t ply_chunk_end(const PLYWriteElement& element, int64_t row_begin, int64_t max_bytes, PLYWriteFormat format);
+
+// Interleaves rows [row_begin, row_end) of `element` into `dest`, which must
+// have room for `ply_rows_size(element, row_begin, row_end)` bytes. Blocks
+// of rows are filled in parallel.
+void write_ply_rows(const PLYWriteElement& element, int64_t row_begin, int64_t row_end, char* dest,
+                    PLYByteOrder byte_order = PLYByteOrder::Native);
+
+// Copies rows [row_begin, row_end) of `property` (not a ragged list) to
+// `dest`, `dest_stride` bytes apart, as they are laid out in a binary body
+// whose rows are `dest_stride` bytes long. Blocks of rows are copied in
+// parallel.
+void write_ply_column(const PLYWriteProperty& property, int64_t row_begin, int64_t row_end, char* dest,
+                      int64_t dest_stride, PLYByteOrder byte_order = PLYByteOrder::Native);
+
+// Writes the whole binary body of `elements` into `dest`, which must have
+// room for `ply_body_size(elements)` bytes.
+void write_ply_body(const std::vector<PLYWriteElement>& elements, char* dest,
+                    PLYByteOrder byte_order = PLYByteOrder::Native);
+
+// Writes `header` and the binary body of `elements` in `byte_order` to the
+// file at `path` through a shared memory mapping of it: the file is sized to
+// its exact final size up front and elements are interleaved straight into
+// the page cache, in parallel, without going through a write buffer. With
+// `sync`, returns once the data is on stable storage.
+//
+// Returns false before writing anything if `path` can't be mapped for
+// writing (not a regular file, or not supported here). Throws
+// std::runtime_error if the file can't be created or sized, e.g. for lack of
+// space, which is reserved before the mapping is touched.
+bool write_ply_mapped(const std::string& path, const std::string& header,
+                      const std::vector<PLYWriteElement>& elements, PLYByteOrder byte_order, bool sync);
+
+// Flushes the data of the file at `path` to stable storage.
+void sync_file(const std::string& path);
+
+// Most bytes rows [row_begin, row_end) of `element` take as ASCII lines.
+int64_t ply_ascii_rows_bound(const PLYWriteElement& element, int64_t row_begin, int64_t row_end);
+
+// Appends rows [row_begin, row_end) of `element` to `dest` as ASCII lines.
+// Floating-point values get `precision` significant digits (at most 17) or,
+// if it is 0, the fewest digits that read back as the same value. Blocks of
+// rows are formatted in parallel, then appended in order.
+void format_ply_rows(const PLYWriteElement& element, int64_t row_begin, int64_t row_end, int precision,
+                     std::string& dest);
+
+#endif // PLYTORCH_PLY_WRITER_H
@@ -0,0 +1,267 @@
+#include "read_plan.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
+
+#include "parallel.h"
+
+
+namespace {
+
+// Smaller files are read faster than they are mapped: setting up the mapping
+// and faulting in its pages costs more than a few buffered reads.
+constexpr int64_t kMapMinBytes = 4 << 20;
+
+// Nor are smaller files worth opening a second reader on.
+constexpr int64_t kParallelMinBytes = 2 << 20;
+
+// Data worth a thread of its own when picking the thread count.
+constexpr int64_t kBytesPerThread = 4 << 20;
+
+// Pages whose residency is queried by one mincore call.
+constexpr size_t kResidencyPagesPerCall = 1 << 16;
+
+#ifdef __linux__
+struct FilesystemType {
+    int64_t magic;
+    const char* name;
+    bool remote;
+};
+
+// From linux/magic.h and the filesystems themselves.
+const FilesystemType kFilesystemTypes[] = {
+    {0xEF53, "ext4", false},
+    {0x58465342, "xfs", false},
+    {0x9123683E, "btrfs", false},
+    {0x2FC12FC1, "zfs", false},
+    {0xF2F52010, "f2fs", false},
+    {0x01021994, "tmpfs", false},
+    {0x794C7630, "overlayfs", false},
+    {0x4D44, "vfat", false},
+    {0x5346544E, "ntfs", false},
+    {0x6969, "nfs", true},
+    {0xFF534D42, "cifs", true},
+    {0xFE534D42, "smb2", true},
+    {0x65735546, "fuse", true},
+    {0x00C36400, "ceph", true},
+    {0x0BD00BD0, "lustre", true},
+    {0x47504653, "gpfs", true},
+};
+#endif
+
+int64_t known_data_bytes(miniply::PLYReader& reader) {
+    int64_t bytes = 0;
+    for (uint32_t i = 0; i != reader.num_elements(); ++i) {
+        const miniply::PLYElement* element = reader.get_element(i);
+        if (element->fixedSize) {
+            bytes += int64_t(element->rowStride) * element->count;
+        }
+    }
+    return bytes;
+}
+
+std::string megabytes(int64_t bytes) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.1f MB", double(bytes) / double(1 << 20));
+    return text;
+}
+
+} // namespace
+
+
+const char* read_strategy_name(ReadStrategy strategy) {
+    switch (strategy) {
+        case ReadStrategy::Auto:
+            return "auto";
+        case ReadStrategy::Buffered:
+            return "buffered";
+        case ReadStrategy::Parallel:
+            return "parallel";
+        case ReadStrategy::Mapped:
+            return "mmap";
+        case ReadStrategy::Stream:
+            return "stream";
+    }
+    return "auto";
+}
+
+ReadStrategy parse_read_strategy(const std::string& name) {
+    for (ReadStrategy strategy : {ReadStrategy::Auto, ReadStrategy::Buffered, ReadStrategy::Parallel,
+                                  ReadStrategy::Mapped, ReadStrategy::Stream}) {
+        if (name == read_strategy_name(strategy)) {
+            return strategy;
+        }
+    }
+    if (name.empty()) {
+        return ReadStrategy::Auto;
+    }
+    throw std::runtime_error("unknown read strategy '" + name +
+                             "', expected one of auto, buffered, parallel, mmap, stream");
+}
+
+StorageInfo probe_storage(const std::string& path, bool probe_residency) {
+    StorageInfo info;
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return info;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        info.regular_file = true;
+        info.file_size = int64_t(st.st_size);
+    }
+
+#ifdef __linux__
+    struct statfs fs;
+    if (::fstatfs(fd, &fs) == 0) {
+        for (const FilesystemType& type : kFilesystemTypes) {
+            if (int64_t(fs.f_type) == type.magic) {
+                info.filesystem = type.name;
+                info.remote = type.remote;
+                break;
+            }
+        }
+    }
+#endif
+
+    if (probe_residency && info.regular_file && info.file_size > 0) {
+        size_t size = size_t(info.file_size);
+        void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr != MAP_FAILED) {
+            size_t page_size = size_t(::sysconf(_SC_PAGESIZE));
+            size_t num_pages = (size + page_size - 1) / page_size;
+            std::vector<unsigned char> resident(std::min(num_pages, kResidencyPagesPerCall));
+            size_t num_resident = 0;
+            bool ok = true;
+            for (size_t page = 0; ok && page < num_pages; page += resident.size()) {
+                size_t count = std::min(resident.size(), num_pages - page);
+                ok = ::mincore(static_cast<char*>(addr) + page * page_size, count * page_size, resident.data()) == 0;
+                for (size_t i = 0; ok && i != count; ++i) {
+                    num_resident += resident[i] & 1;
+                }
+            }
+            if (ok) {
+                info.resident_fraction = double(num_resident) / double(num_pages);
+            }
+            ::munmap(addr, size);
+        }
+    }
+    ::close(fd);
+#endif
+    return info;
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path) {
+#ifdef _WIN32
+    return nullptr;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    size_t size = size_t(st.st_size);
+    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file referenced on its own.
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return nullptr;
+    }
+    // Elements are extracted front to back, so read ahead aggressively.
+    ::madvise(addr, size, MADV_SEQUENTIAL);
+    return std::shared_ptr<MappedFile>(new MappedFile(static_cast<const uint8_t*>(addr), size));
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    ::munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+}
+
+std::unique_ptr<miniply::PLYSource> MappedFile::source() const {
+    return std::make_unique<miniply::PLYMemorySource>(m_data, m_size);
+}
+
+ReadPlan plan_read(const std::string& path, miniply::PLYReader& reader, ReadStrategy requested, int64_t threads) {
+    ReadPlan plan;
+    bool binary = reader.file_type() != miniply::PLYFileType::ASCII;
+    bool little_endian = reader.file_type() == miniply::PLYFileType::Binary;
+
+    const bool front_to_back = !reader.seekable() || path == "-";
+    const char* front_to_back_reason =
+        "the data can only be read front to back (pipe, standard input or compressed)";
+    if (front_to_back && (requested == ReadStrategy::Mapped || requested == ReadStrategy::Parallel)) {
+        // Neither can be done without opening the file again, and "-" is
+        // standard input, not a file of that name.
+        plan.strategy = ReadStrategy::Stream;
+        plan.reason = std::string(read_strategy_name(requested)) + " was requested, but " + front_to_back_reason;
+    } else if (requested != ReadStrategy::Auto) {
+        plan.strategy = requested;
+        plan.reason = "requested";
+        if (path != "-") {
+            plan.storage = probe_storage(path, false);
+        }
+    } else if (front_to_back) {
+        plan.strategy = ReadStrategy::Stream;
+        plan.reason = front_to_back_reason;
+    } else {
+        plan.storage = probe_storage(path, false);
+        const StorageInfo& storage = plan.storage;
+        std::string where = megabytes(storage.file_size) +
+                            (storage.filesystem.empty() ? std::string() : " on " + storage.filesystem);
+        if (!storage.regular_file) {
+            plan.strategy = ReadStrategy::Stream;
+            plan.reason = "not a regular file";
+        } else if (!binary) {
+            plan.strategy = ReadStrategy::Buffered;
+            plan.reason = "ASCII elements can only be parsed one after another";
+        } else if (storage.file_size < kParallelMinBytes) {
+            plan.strategy = ReadStrategy::Buffered;
+            plan.reason = where + ", too small to split";
+        } else if (!little_endian || storage.file_size < kMapMinBytes) {
+            plan.strategy = ReadStrategy::Parallel;
+            plan.reason = where + (little_endian ? ", too small to map" : ", big-endian data is swapped in copies");
+        } else {
+            plan.storage = probe_storage(path, true);
+            double resident = plan.storage.resident_fraction;
+            if (resident >= 0.0) {
+                where += ", " + std::to_string(int(resident * 100.0 + 0.5)) + "% cached";
+            }
+            if (plan.storage.remote && resident < 0.5) {
+                // Page faults would fetch the file a page at a time, while
+                // readers of their own keep several large requests in flight.
+                plan.strategy = ReadStrategy::Parallel;
+                plan.reason = where + ", remote";
+            } else {
+                plan.strategy = ReadStrategy::Mapped;
+                plan.reason = where + ", little-endian data is extracted in place";
+            }
+        }
+    }
+
+    if (threads > 0) {
+        plan.threads = std::min(threads, num_worker_threads());
+    } else {
+        int64_t bytes = plan.storage.file_size > 0 ? plan.storage.file_size : known_data_bytes(reader);
+        plan.threads = std::clamp<int64_t>(bytes / kBytesPerThread, 1, num_worker_threads());
+    }
+    return plan;
+}
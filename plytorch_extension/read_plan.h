@@ -0,0 +1,78 @@
+#ifndef PLYTORCH_READ_PLAN_H
+#define PLYTORCH_READ_PLAN_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "miniply.h"
+
+
+// How a PLY file is read:
+// - Buffered: through the read buffer of a single reader, element after element;
+// - Parallel: the same, with elements whose offsets are known decoded at the
+//   same time through readers of their own;
+// - Mapped: the file is memory-mapped and binary little-endian data is
+//   extracted in place, elements in parallel;
+// - Stream: front to back without ever seeking, as for pipes or compressed data.
+enum class ReadStrategy { Auto, Buffered, Parallel, Mapped, Stream };
+
+const char* read_strategy_name(ReadStrategy strategy);
+// Throws std::runtime_error for unknown names.
+ReadStrategy parse_read_strategy(const std::string& name);
+
+// What can be found out cheaply about where a file is stored.
+struct StorageInfo {
+    bool regular_file = false;
+    int64_t file_size = -1;
+    // Share of the file's pages in the page cache, or -1 if not probed.
+    double resident_fraction = -1.0;
+    // Filesystem type (e.g. "ext4", "nfs", "tmpfs"), empty if unknown.
+    std::string filesystem;
+    // Network or FUSE filesystem, where each page fault may be a round trip.
+    bool remote = false;
+};
+
+// Stats `path` and its filesystem. With `probe_residency`, also counts the
+// pages of the file in the page cache (through mmap and mincore).
+StorageInfo probe_storage(const std::string& path, bool probe_residency);
+
+// A file memory-mapped read-only, unmapped when destroyed. Readers get at it
+// through `PLYMemorySource`s, any number of them at once.
+class MappedFile {
+public:
+    // Returns nullptr if `path` can't be mapped (not a regular file, empty,
+    // or not supported here).
+    static std::shared_ptr<MappedFile> open(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    std::unique_ptr<miniply::PLYSource> source() const;
+
+private:
+    MappedFile(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    const uint8_t* m_data;
+    size_t m_size;
+};
+
+// The strategy and thread count chosen for a read, and why.
+struct ReadPlan {
+    ReadStrategy strategy = ReadStrategy::Buffered;
+    int64_t threads = 1;
+    std::string reason;
+    StorageInfo storage;
+};
+
+// Picks how to read the file at `path`, whose header `reader` has parsed,
+// unless `requested` already says so. `threads` is the requested thread count,
+// at most `num_worker_threads()`, 0 to pick one. Storage is probed only as far
+// as the choice depends on it.
+ReadPlan plan_read(const std::string& path, miniply::PLYReader& reader, ReadStrategy requested, int64_t threads);
+
+#endif // PLYTORCH_READ_PLAN_H
@@ -0,0 +1,233 @@
+#include "tar_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace {
+
+constexpr size_t kTarBlockSize = 512;
+
+// Skipped member data is read and discarded in pieces of this size.
+constexpr size_t kSkipChunkSize = 64 * 1024;
+
+// Digits of the length of a pax record: more than any record can take, and
+// few enough for the length not to overflow.
+constexpr size_t kMaxPaxLengthDigits = 18;
+
+// Shell-style wildcard match: `*` matches any run of characters (including
+// '/'), `?` any single character.
+bool wildcard_match(const char* pattern, const char* name) {
+    const char* star = nullptr;
+    const char* resume = nullptr;
+    while (*name != '\0') {
+        if (*pattern == '*') {
+            star = pattern++;
+            resume = name;
+        } else if (*pattern == '?' || *pattern == *name) {
+            ++pattern;
+            ++name;
+        } else if (star != nullptr) {
+            pattern = star + 1;
+            name = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '*') {
+        ++pattern;
+    }
+    return *pattern == '\0';
+}
+
+std::string field_string(const uint8_t* field, size_t size) {
+    const char* begin = reinterpret_cast<const char*>(field);
+    return std::string(begin, std::find(begin, begin + size, '\0'));
+}
+
+// Numeric header field: octal text, or big-endian base-256 if the high bit of
+// the first byte is set (used by GNU tar for members of 8 GB and more).
+uint64_t parse_number(const uint8_t* field, size_t size) {
+    uint64_t value = 0;
+    if (field[0] & 0x80) {
+        value = field[0] & 0x7f;
+        for (size_t i = 1; i < size; ++i) {
+            value = (value << 8) | field[i];
+        }
+        return value;
+    }
+    for (size_t i = 0; i < size && field[i] != '\0'; ++i) {
+        if (field[i] >= '0' && field[i] <= '7') {
+            value = (value << 3) | uint64_t(field[i] - '0');
+        }
+    }
+    return value;
+}
+
+bool is_zero_block(const uint8_t* block) {
+    return std::all_of(block, block + kTarBlockSize, [](uint8_t b) { return b == 0; });
+}
+
+bool checksum_matches(const uint8_t* header) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < kTarBlockSize; ++i) {
+        // The checksum field itself counts as spaces.
+        sum += (i >= 148 && i < 156) ? uint8_t(' ') : header[i];
+    }
+    return sum == parse_number(header + 148, 8);
+}
+
+std::string member_name(const uint8_t* header) {
+    std::string name = field_string(header, 100);
+    if (std::memcmp(header + 257, "ustar", 5) == 0) {
+        std::string prefix = field_string(header + 345, 155);
+        if (!prefix.empty()) {
+            name = prefix + "/" + name;
+        }
+    }
+    return name;
+}
+
+// The "path" record of a pax extended header, or an empty string. Throws
+// std::runtime_error if the records are malformed.
+std::string pax_path(const std::vector<uint8_t>& records) {
+    size_t pos = 0;
+    while (pos < records.size()) {
+        // Each record is "<length> <key>=<value>\n", the length counting the whole record.
+        size_t length = 0;
+        size_t i = pos;
+        while (i < records.size() && i - pos < kMaxPaxLengthDigits && records[i] >= '0' && records[i] <= '9') {
+            length = length * 10 + size_t(records[i++] - '0');
+        }
+        if (i == pos || i == records.size() || records[i] != ' ' || length > records.size() - pos ||
+            i + 2 > pos + length || records[pos + length - 1] != '\n') {
+            throw std::runtime_error("malformed pax extended header in tar archive");
+        }
+        std::string record(records.begin() + i + 1, records.begin() + pos + length - 1);
+        if (record.compare(0, 5, "path=") == 0) {
+            return record.substr(5);
+        }
+        pos += length;
+    }
+    return std::string();
+}
+
+} // namespace
+
+
+TarReader::TarReader(std::unique_ptr<miniply::PLYSource> source, std::vector<std::string> patterns) :
+    m_source(std::move(source)), m_patterns(std::move(patterns)) {
+    m_next = std::async(std::launch::async, &TarReader::read_member, this);
+}
+
+TarReader::~TarReader() {
+    if (m_next.valid()) {
+        m_next.wait();
+    }
+}
+
+std::optional<TarMember> TarReader::next() {
+    if (m_done) {
+        return std::nullopt;
+    }
+    std::optional<TarMember> member;
+    try {
+        member = m_next.get();
+    } catch (...) {
+        m_done = true;
+        throw;
+    }
+    if (member) {
+        m_next = std::async(std::launch::async, &TarReader::read_member, this);
+    } else {
+        m_done = true;
+    }
+    return member;
+}
+
+std::optional<TarMember> TarReader::read_member() {
+    std::string long_name;
+    uint8_t header[kTarBlockSize];
+    while (true) {
+        size_t n = 0;
+        while (n < kTarBlockSize) {
+            size_t got = m_source->read(header + n, kTarBlockSize - n);
+            if (got == 0) {
+                break;
+            }
+            n += got;
+        }
+        if (n == 0 || (n == kTarBlockSize && is_zero_block(header))) {
+            // End of the archive, with or without its end-of-archive blocks.
+            return std::nullopt;
+        }
+        if (n != kTarBlockSize || !checksum_matches(header)) {
+            throw std::runtime_error("malformed tar header");
+        }
+
+        uint64_t size = parse_number(header + 124, 12);
+        uint64_t padding = (kTarBlockSize - size % kTarBlockSize) % kTarBlockSize;
+        char type = char(header[156]);
+
+        if (type == 'L' || type == 'x') {
+            // GNU long name, or pax extended header, for the next member.
+            std::vector<uint8_t> extension(size);
+            read_exactly(extension.data(), extension.size());
+            skip(padding);
+            if (type == 'L') {
+                long_name = field_string(extension.data(), extension.size());
+            } else {
+                std::string path = pax_path(extension);
+                if (!path.empty()) {
+                    long_name = path;
+                }
+            }
+            continue;
+        }
+
+        std::string name = long_name.empty() ? member_name(header) : long_name;
+        long_name.clear();
+        bool regular_file = type == '0' || type == '\0' || type == '7';
+        if (!regular_file || !selected(name)) {
+            skip(size + padding);
+            continue;
+        }
+
+        TarMember member;
+        member.name = std::move(name);
+        member.data.resize(size);
+        read_exactly(member.data.data(), member.data.size());
+        skip(padding);
+        return member;
+    }
+}
+
+bool TarReader::selected(const std::string& name) const {
+    if (m_patterns.empty()) {
+        return true;
+    }
+    return std::any_of(m_patterns.begin(), m_patterns.end(), [&name](const std::string& pattern) {
+        return wildcard_match(pattern.c_str(), name.c_str());
+    });
+}
+
+void TarReader::read_exactly(void* dest, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+        size_t n = m_source->read(static_cast<uint8_t*>(dest) + total, size - total);
+        if (n == 0) {
+            throw std::runtime_error("truncated tar archive");
+        }
+        total += n;
+    }
+}
+
+void TarReader::skip(uint64_t size) {
+    std::vector<uint8_t> scratch(std::min<uint64_t>(size, kSkipChunkSize));
+    while (size > 0) {
+        size_t chunk = size_t(std::min<uint64_t>(size, scratch.size()));
+        read_exactly(scratch.data(), chunk);
+        size -= chunk;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef PLYTORCH_TAR_READER_H
+#define PLYTORCH_TAR_READER_H
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "miniply.h"
+
+
+// A regular file stored in a tar archive.
+struct TarMember {
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+// Reads the regular files of a tar archive front to back. Only members whose
+// name matches one of `patterns` (shell wildcards, all members if empty) are
+// read into memory; the others are skipped. The next selected member is read
+// on a background thread while the caller works on the current one.
+// Understands ustar and GNU long names, pax paths, and base-256 sizes.
+class TarReader {
+public:
+    TarReader(std::unique_ptr<miniply::PLYSource> source, std::vector<std::string> patterns);
+    ~TarReader();
+
+    // The next selected member, or nothing at the end of the archive. Throws
+    // std::runtime_error if the archive is malformed or truncated.
+    std::optional<TarMember> next();
+
+private:
+    std::optional<TarMember> read_member();
+    bool selected(const std::string& name) const;
+    void read_exactly(void* dest, size_t size);
+    void skip(uint64_t size);
+
+    std::unique_ptr<miniply::PLYSource> m_source;
+    std::vector<std::string> m_patterns;
+    std::future<std::optional<TarMember>> m_next;
+    bool m_done = false;
+};
+
+#endif // PLYTORCH_TAR_READER_H
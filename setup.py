@@ -5,7 +5,18 @@ setup(
     name='plytorch',
     packages=['plytorch'],
     ext_modules=[
-        CppExtension('_plytorch_extension', ['plytorch_extension/main.cpp', 'plytorch_extension/miniply.cpp']),
+        CppExtension('_plytorch_extension', [
+            'plytorch_extension/main.cpp',
+            'plytorch_extension/miniply.cpp',
+            'plytorch_extension/mesh_ops.cpp',
+            'plytorch_extension/ply_writer.cpp',
+            'plytorch_extension/ply_edit.cpp',
+            'plytorch_extension/ply_follow.cpp',
+            'plytorch_extension/ply_stats.cpp',
+            'plytorch_extension/read_plan.cpp',
+            'plytorch_extension/gzip_io.cpp',
+            'plytorch_extension/tar_reader.cpp',
+        ], libraries=['z']),
     ],
     cmdclass={
         'build_ext': BuildExtension